@@ -0,0 +1,315 @@
+#include <lib/ArgParser.h>
+#include <bin/Reduction.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <numeric>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Every measurement is printed as one JSON object per line:
+// {"benchmark": ..., "variant": ..., "parameter": ..., "iterations": ...,
+//  "ns_per_op": ..., "allocations_per_op": ...}
+
+namespace {
+    std::atomic<uint64_t> allocations{0};
+}
+
+void* operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* pointer = std::malloc(size == 0 ? 1 : size)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept {
+    std::free(pointer);
+}
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    struct Settings {
+        uint64_t max_keys = 10000;
+        uint64_t max_tokens = 1000000;
+        std::chrono::nanoseconds min_time = std::chrono::milliseconds(50);
+    };
+
+    class Tokens {
+     private:
+        std::vector<std::string> storage_;
+        std::vector<std::string_view> views_;
+     public:
+        explicit Tokens(std::vector<std::string> storage) : storage_(std::move(storage)) {
+            views_.assign(storage_.begin(), storage_.end());
+        }
+
+        [[nodiscard]] std::span<const std::string_view> View() const {
+            return views_;
+        }
+    };
+
+    void Report(std::string_view benchmark, std::string_view variant, uint64_t parameter,
+                uint64_t iterations, double ns_per_op, double allocations_per_op) {
+        std::cout << "{\"benchmark\": \"" << benchmark << "\", \"variant\": \"" << variant
+                  << "\", \"parameter\": " << parameter << ", \"iterations\": " << iterations
+                  << ", \"ns_per_op\": " << ns_per_op << ", \"allocations_per_op\": " << allocations_per_op
+                  << "}" << std::endl;
+    }
+
+    // Runs body until min_time has passed; ops_per_call scales the per-op figures.
+    template<typename Body>
+    void Measure(const Settings& settings, std::string_view benchmark, std::string_view variant,
+                 uint64_t parameter, uint64_t ops_per_call, Body&& body) {
+        uint64_t iterations = 0;
+        uint64_t allocations_before = allocations.load(std::memory_order_relaxed);
+        auto start = Clock::now();
+        auto elapsed = Clock::duration::zero();
+        while (iterations == 0 || elapsed < settings.min_time) {
+            body();
+            iterations++;
+            elapsed = Clock::now() - start;
+        }
+        uint64_t allocated = allocations.load(std::memory_order_relaxed) - allocations_before;
+        double ops = static_cast<double>(iterations * ops_per_call);
+        Report(benchmark, variant, parameter, iterations,
+               std::chrono::duration<double, std::nano>(elapsed).count() / ops, allocated / ops);
+    }
+
+    std::vector<std::string> KeyNames(uint64_t count) {
+        std::vector<std::string> names;
+        names.reserve(count);
+        for (uint64_t i = 0; i < count; i++) {
+            names.push_back("key" + std::to_string(i));
+        }
+        return names;
+    }
+
+    void BuildSchema(ArgumentParser::ArgParser& parser, const std::vector<std::string>& names) {
+        for (size_t i = 0; i < names.size(); i++) {
+            if (i % 2 == 0) {
+                parser.AddIntArgument(names[i], "Integer option").Default(0);
+            } else {
+                parser.AddFlag(names[i], "Flag option");
+            }
+        }
+        parser.AddHelp('h', "help", "Benchmark schema");
+    }
+
+    void SchemaConstruction(const Settings& settings) {
+        for (uint64_t keys = 10; keys <= settings.max_keys; keys *= 10) {
+            std::vector<std::string> names = KeyNames(keys);
+            Measure(settings, "schema_construction", "add_and_freeze", keys, 1, [&names] {
+                ArgumentParser::ArgParser parser("bench");
+                BuildSchema(parser, names);
+                parser.Freeze();
+            });
+        }
+    }
+
+    void ParseBySchemaSize(const Settings& settings) {
+        for (uint64_t keys = 10; keys <= settings.max_keys; keys *= 10) {
+            std::vector<std::string> names = KeyNames(keys);
+            ArgumentParser::ArgParser parser("bench");
+            BuildSchema(parser, names);
+            parser.Freeze();
+            Tokens tokens({
+                "app", "--" + names[0] + "=1", "--" + names[1], "--" + names[keys - 2], "7",
+                "--" + names[keys / 2 - keys / 2 % 2] + "=3", "--" + names[keys - 1]
+            });
+            Measure(settings, "parse_schema_size", "mixed_long_keys", keys, 1, [&] {
+                parser.Reset();
+                parser.Parse(tokens.View());
+            });
+            Measure(settings, "parse_schema_size", "parse_to_result", keys, 1, [&] {
+                (void) parser.ParseToResult(tokens.View());
+            });
+        }
+    }
+
+    void ParseByArgvLength(const Settings& settings) {
+        std::vector<int> values;
+        ArgumentParser::ArgParser parser("bench");
+        parser.AddIntArgument("N").MultiValue(1).Positional().StoreValues(values);
+        parser.AddFlag("sum", "add args");
+        parser.Freeze();
+        for (uint64_t length = 1; length <= settings.max_tokens; length *= 10) {
+            std::vector<std::string> storage = {"app", "--sum"};
+            for (uint64_t i = 0; i < length; i++) {
+                storage.push_back(std::to_string(i * 7919 % 1000003));
+            }
+            Tokens tokens(std::move(storage));
+            Measure(settings, "parse_argv_length", "positional_int", length, 1, [&] {
+                parser.Reset();
+                parser.Parse(tokens.View());
+            });
+        }
+    }
+
+    void ParseByForm(const Settings& settings) {
+        constexpr uint64_t kTokens = 10000;
+        std::vector<int> values;
+        ArgumentParser::ArgParser parser("bench");
+        parser.AddIntArgument('v', "value").MultiValue().StoreValues(values);
+        parser.AddIntArgument("N").MultiValue().Positional();
+        for (char flag = 'a'; flag <= 'f'; flag++) {
+            parser.AddFlag(flag, std::string("flag_") + flag);
+        }
+        parser.Freeze();
+
+        auto run = [&](std::string_view form, uint64_t ops, std::vector<std::string> storage) {
+            storage.insert(storage.begin(), "app");
+            Tokens tokens(std::move(storage));
+            Measure(settings, "parse_form", form, ops, ops, [&] {
+                parser.Reset();
+                parser.Parse(tokens.View());
+            });
+        };
+
+        std::vector<std::string> positional;
+        std::vector<std::string> clusters;
+        std::vector<std::string> equals;
+        std::vector<std::string> separate;
+        for (uint64_t i = 0; i < kTokens; i++) {
+            positional.push_back(std::to_string(i));
+            clusters.emplace_back("-abcdef");
+            equals.push_back("--value=" + std::to_string(i));
+            separate.emplace_back(i % 2 == 0 ? "-v" : std::to_string(i));
+        }
+        run("positional", kTokens, std::move(positional));
+        run("short_cluster", kTokens, std::move(clusters));
+        run("long_equals", kTokens, std::move(equals));
+        run("short_separate_value", kTokens / 2, std::move(separate));
+    }
+
+    void ValueAccess(const Settings& settings) {
+        constexpr uint64_t kReads = 1000;
+        std::vector<std::string> names = KeyNames(100);
+        ArgumentParser::ArgParser parser("bench");
+        BuildSchema(parser, names);
+        ArgumentParser::IntHandle handle = parser.AddIntArgument("target", "Read in a loop").Default(1).Handle();
+        parser.Parse(std::vector<std::string>{"app"});
+
+        volatile int sink = 0;
+        Measure(settings, "value_access", "by_key", kReads, kReads, [&] {
+            for (uint64_t i = 0; i < kReads; i++) {
+                sink = sink + parser.GetIntValue("target");
+            }
+        });
+        Measure(settings, "value_access", "by_handle", kReads, kReads, [&] {
+            for (uint64_t i = 0; i < kReads; i++) {
+                sink = sink + parser.Get(handle);
+            }
+        });
+    }
+
+    // Every option is supplied and only one of them is read.
+    void LazyConversion(const Settings& settings) {
+        constexpr uint64_t kOptions = 100;
+        std::vector<std::string> names = KeyNames(kOptions);
+        std::vector<std::string> storage = {"app"};
+        for (uint64_t i = 0; i < kOptions; i++) {
+            storage.push_back("--" + names[i] + "=" + (i % 2 == 0 ? std::to_string(i * 7919) : "a-value-past-short-string-size"));
+        }
+        Tokens tokens(std::move(storage));
+        for (bool lazy : {false, true}) {
+            ArgumentParser::ArgParser parser("bench");
+            for (uint64_t i = 0; i < kOptions; i++) {
+                if (i % 2 == 0) {
+                    parser.AddIntArgument(names[i]);
+                } else {
+                    parser.AddStringArgument(names[i]);
+                }
+            }
+            parser.SetLazyConversion(lazy);
+            parser.Freeze();
+            volatile int sink = 0;
+            Measure(settings, "lazy_conversion", lazy ? "lazy" : "eager", kOptions, 1, [&] {
+                parser.Reset();
+                parser.Parse(tokens.View());
+                sink = sink + parser.GetIntValue(names[0]);
+            });
+        }
+    }
+
+    // labwork5's reduction: a serial int64 accumulate, the int one it used to
+    // run overflows here, against the checked engine on one and on all
+    // hardware threads, and with its portable kernels on one.
+    void Reduce(const Settings& settings) {
+        for (uint64_t length = 1000; length <= settings.max_tokens; length *= 10) {
+            std::vector<int> values(length);
+            for (uint64_t i = 0; i < length; i++) {
+                values[i] = static_cast<int>(i * 7919 % 1000003);
+            }
+            volatile int64_t sink = 0;
+            Measure(settings, "reduction", "accumulate_int64", length, length, [&] {
+                sink = sink + std::accumulate(values.begin(), values.end(), int64_t{0});
+            });
+            Measure(settings, "reduction", "sum_1_thread", length, length, [&] {
+                sink = sink + Reduction::Sum(values, 1).value;
+            });
+            Measure(settings, "reduction", "sum_all_threads", length, length, [&] {
+                sink = sink + Reduction::Sum(values, 0).value;
+            });
+            Reduction::SetVectorKernels(false);
+            Measure(settings, "reduction", "sum_1_thread_scalar", length, length, [&] {
+                sink = sink + Reduction::Sum(values, 1).value;
+            });
+            Reduction::SetVectorKernels(true);
+        }
+    }
+
+    void HelpDescription(const Settings& settings) {
+        for (uint64_t keys = 10; keys <= settings.max_keys; keys *= 10) {
+            std::vector<std::string> names = KeyNames(keys);
+            ArgumentParser::ArgParser parser("bench");
+            BuildSchema(parser, names);
+            parser.Freeze();
+            Measure(settings, "help_description", "freeze_and_render", keys, 1, [&parser] {
+                parser.Freeze();
+                (void) parser.HelpDescription();
+            });
+            Measure(settings, "help_description", "cached", keys, 1, [&parser] {
+                (void) parser.HelpDescription();
+            });
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    ArgumentParser::ArgParser options("argparser_bench");
+    options.AddIntArgument("max-keys", "Largest schema size").Default(10000);
+    options.AddIntArgument("max-tokens", "Longest argv").Default(1000000);
+    options.AddIntArgument("min-time-ms", "Minimal duration of one measurement").Default(50);
+    options.AddHelp('h', "help", "Parser benchmarks, results are printed as JSON lines");
+
+    if (!options.Parse(argc, argv) || options.Help()) {
+        std::cout << options.HelpDescription() << std::endl;
+        return options.Help() ? 0 : 1;
+    }
+
+    Settings settings;
+    settings.max_keys = options.GetIntValue("max-keys");
+    settings.max_tokens = options.GetIntValue("max-tokens");
+    settings.min_time = std::chrono::milliseconds(options.GetIntValue("min-time-ms"));
+
+    SchemaConstruction(settings);
+    ParseBySchemaSize(settings);
+    ParseByArgvLength(settings);
+    ParseByForm(settings);
+    ValueAccess(settings);
+    LazyConversion(settings);
+    Reduce(settings);
+    HelpDescription(settings);
+
+    return 0;
+}
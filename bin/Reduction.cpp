@@ -0,0 +1,247 @@
+#include "Reduction.h"
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <stdexcept>
+#include <thread>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define REDUCTION_AVX2_KERNEL 1
+#endif
+
+namespace Reduction {
+
+    namespace {
+        // Longest run a kernel sums without checks: 2^31 values of at most
+        // 2^31 each can't leave int64.
+        constexpr size_t kUncheckedRun = size_t{1} << 31;
+
+        std::atomic<bool> vector_kernels{true};
+
+        bool CheckedAdd(int64_t first, int64_t second, int64_t& result) {
+#if defined(__GNUC__)
+            return !__builtin_add_overflow(first, second, &result);
+#else
+            if ((second > 0 && first > std::numeric_limits<int64_t>::max() - second)
+                || (second < 0 && first < std::numeric_limits<int64_t>::min() - second)) {
+                return false;
+            }
+            result = first + second;
+            return true;
+#endif
+        }
+
+        bool CheckedMultiply(int64_t first, int64_t second, int64_t& result) {
+#if defined(__GNUC__)
+            return !__builtin_mul_overflow(first, second, &result);
+#else
+            if (first != 0 && second != 0) {
+                if ((first == -1 && second == std::numeric_limits<int64_t>::min())
+                    || (second == -1 && first == std::numeric_limits<int64_t>::min())) {
+                    return false;
+                }
+                int64_t product = first * second;
+                if (product / second != first) {
+                    return false;
+                }
+            }
+            result = first * second;
+            return true;
+#endif
+        }
+
+        void Combine(Result& total, const Result& part, bool (*operation)(int64_t, int64_t, int64_t&)) {
+            total.overflow = total.overflow || part.overflow || !operation(total.value, part.value, total.value);
+        }
+
+        int64_t SumScalar(const int* values, size_t count) {
+            // Independent lanes let the compiler vectorize the loop.
+            int64_t lanes[8] = {};
+            size_t i = 0;
+            for (; i + 8 <= count; i += 8) {
+                for (size_t lane = 0; lane < 8; lane++) {
+                    lanes[lane] += values[i + lane];
+                }
+            }
+            int64_t sum = 0;
+            for (int64_t lane : lanes) {
+                sum += lane;
+            }
+            for (; i < count; i++) {
+                sum += values[i];
+            }
+            return sum;
+        }
+
+        bool HasZeroScalar(const int* values, size_t count) {
+            return std::find(values, values + count, 0) != values + count;
+        }
+
+#ifdef REDUCTION_AVX2_KERNEL
+        bool HasAvx2() {
+            static const bool has_avx2 = __builtin_cpu_supports("avx2");
+            return has_avx2 && vector_kernels.load(std::memory_order_relaxed);
+        }
+
+        // Widens eight ints to int64 per step into two accumulators.
+        __attribute__((target("avx2")))
+        int64_t SumAvx2(const int* values, size_t count) {
+            __m256i low = _mm256_setzero_si256();
+            __m256i high = _mm256_setzero_si256();
+            size_t i = 0;
+            for (; i + 8 <= count; i += 8) {
+                __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i));
+                low = _mm256_add_epi64(low, _mm256_cvtepi32_epi64(_mm256_castsi256_si128(chunk)));
+                high = _mm256_add_epi64(high, _mm256_cvtepi32_epi64(_mm256_extracti128_si256(chunk, 1)));
+            }
+            alignas(32) int64_t lanes[4];
+            _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), _mm256_add_epi64(low, high));
+            int64_t sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+            for (; i < count; i++) {
+                sum += values[i];
+            }
+            return sum;
+        }
+
+        __attribute__((target("avx2")))
+        bool HasZeroAvx2(const int* values, size_t count) {
+            const __m256i zero = _mm256_setzero_si256();
+            size_t i = 0;
+            for (; i + 8 <= count; i += 8) {
+                __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + i));
+                if (_mm256_movemask_epi8(_mm256_cmpeq_epi32(chunk, zero)) != 0) {
+                    return true;
+                }
+            }
+            return HasZeroScalar(values + i, count - i);
+        }
+#endif
+
+        Result SumKernel(std::span<const int> values) {
+            Result result;
+            for (size_t begin = 0; begin < values.size(); begin += kUncheckedRun) {
+                size_t count = std::min(kUncheckedRun, values.size() - begin);
+#ifdef REDUCTION_AVX2_KERNEL
+                int64_t part = HasAvx2() ? SumAvx2(values.data() + begin, count) : SumScalar(values.data() + begin, count);
+#else
+                int64_t part = SumScalar(values.data() + begin, count);
+#endif
+                Combine(result, {part, false}, CheckedAdd);
+            }
+            return result;
+        }
+
+        bool HasZero(std::span<const int> values) {
+#ifdef REDUCTION_AVX2_KERNEL
+            if (HasAvx2()) {
+                return HasZeroAvx2(values.data(), values.size());
+            }
+#endif
+            return HasZeroScalar(values.data(), values.size());
+        }
+
+        // Expects no zeros. Every factor other than 1 and -1 at least doubles
+        // the magnitude, so an overflow shows up within 63 of them.
+        Result ProductKernel(std::span<const int> values) {
+            Result result{1, false};
+            for (int value : values) {
+                if (value != 1 && !CheckedMultiply(result.value, value, result.value)) {
+                    result.overflow = true;
+                    break;
+                }
+            }
+            return result;
+        }
+
+        // Runs kernel over equal chunks of values, one per thread, and folds
+        // the chunk results with operation.
+        template<typename Kernel>
+        Result Parallel(std::span<const int> values, size_t threads, Kernel kernel, Result identity,
+                        bool (*operation)(int64_t, int64_t, int64_t&)) {
+            if (threads == 0) {
+                static const size_t hardware_threads = std::max(1u, std::thread::hardware_concurrency());
+                threads = hardware_threads;
+            }
+            threads = std::min(threads, values.size() / kParallelThreshold);
+            if (threads <= 1) {
+                return kernel(values);
+            }
+            size_t chunk = (values.size() + threads - 1) / threads;
+            std::vector<Result> parts(threads);
+            {
+                std::vector<std::jthread> workers;
+                workers.reserve(threads - 1);
+                for (size_t i = 1; i < threads; i++) {
+                    workers.emplace_back([&, i] {
+                        parts[i] = kernel(values.subspan(i * chunk, std::min(chunk, values.size() - i * chunk)));
+                    });
+                }
+                parts[0] = kernel(values.first(chunk));
+            }
+            Result result = identity;
+            for (const Result& part : parts) {
+                Combine(result, part, operation);
+            }
+            return result;
+        }
+    }
+
+    Result Sum(std::span<const int> values, size_t threads) {
+        return Parallel(values, threads, SumKernel, Result{}, CheckedAdd);
+    }
+
+    Result Product(std::span<const int> values, size_t threads) {
+        if (HasZero(values)) {
+            return {};
+        }
+        return Parallel(values, threads, ProductKernel, Result{1, false}, CheckedMultiply);
+    }
+
+    void SetVectorKernels(bool enabled) {
+        vector_kernels.store(enabled, std::memory_order_relaxed);
+    }
+
+    Accumulator::Accumulator(const int& threads, const bool& sum_chosen)
+        : threads_(&threads), sum_chosen_(&sum_chosen) {}
+
+    void Accumulator::Flush(bool sum, bool product) {
+        if (block_.empty()) {
+            return;
+        }
+        // A negative count is rejected by main once the parse is over.
+        size_t threads = std::max(*threads_, 0);
+        if (sum) {
+            Combine(sum_, Reduction::Sum(block_, threads), CheckedAdd);
+        } else {
+            sum_skipped_ = true;
+        }
+        if (!product) {
+            product_skipped_ = true;
+        } else if (!zero_) {
+            Result part = Reduction::Product(block_, threads);
+            // A product of non-zero values is only 0 when it overflowed.
+            zero_ = part.value == 0 && !part.overflow;
+            Combine(product_, part, CheckedMultiply);
+        }
+        block_.clear();
+    }
+
+    Result Accumulator::Sum() {
+        Flush(true, false);
+        if (sum_skipped_) {
+            throw std::logic_error("Values were only multiplied");
+        }
+        return sum_;
+    }
+
+    Result Accumulator::Product() {
+        Flush(false, true);
+        if (product_skipped_) {
+            throw std::logic_error("Values were only summed");
+        }
+        return zero_ ? Result{} : product_;
+    }
+
+} // namespace Reduction
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace Reduction {
+    // Exact int64 result; overflow is reported instead of wrapping around.
+    struct Result {
+        int64_t value = 0;
+        bool overflow = false;
+    };
+
+    // Inputs are split between threads only in chunks of at least this many
+    // values, shorter ones are reduced on the calling thread.
+    constexpr size_t kParallelThreshold = size_t{1} << 16;
+
+    // threads == 0 means one per hardware thread.
+    Result Sum(std::span<const int> values, size_t threads = 1);
+
+    Result Product(std::span<const int> values, size_t threads = 1);
+
+    // With false Sum and Product use the portable kernels even where AVX2 is
+    // available, so tests and benchmarks can compare the two. Not meant to
+    // be switched while a reduction is running.
+    void SetVectorKernels(bool enabled);
+
+    // Reduces a stream of values block by block, so memory stays bounded by
+    // kBlockSize however many values are added. The choice between sum and
+    // product may come after the values: full blocks are summed, and also
+    // multiplied until sum_chosen is set. The last block is reduced only
+    // the way Sum() or Product() needs, the other one throws after that.
+    class Accumulator {
+     private:
+        std::vector<int> block_;
+        const int* threads_;
+        const bool* sum_chosen_;
+        Result sum_;
+        Result product_{1, false};
+        bool zero_ = false;
+        bool sum_skipped_ = false;
+        bool product_skipped_ = false;
+
+        void Flush(bool sum, bool product);
+     public:
+        static constexpr size_t kBlockSize = size_t{1} << 20;
+
+        // threads and sum_chosen are read at every flush, so they may be set
+        // while values are already coming in.
+        Accumulator(const int& threads, const bool& sum_chosen);
+
+        void Add(int value) {
+            block_.push_back(value);
+            if (block_.size() == kBlockSize) {
+                Flush(true, !*sum_chosen_);
+            }
+        }
+
+        Result Sum();
+
+        Result Product();
+    };
+
+} // namespace Reduction
@@ -1,8 +1,9 @@
-#include <functional>
 #include <lib/ArgParser.h>
 
+#include "Reduction.h"
+
+#include <fstream>
 #include <iostream>
-#include <numeric>
 
 struct Options {
     bool sum = false;
@@ -12,16 +13,46 @@ struct Options {
 int main(int argc, char** argv) {
     using namespace ArgumentParser;
     Options opt;
-    std::vector<int> values;
-
+    int threads = 0;
+    // --sum wins over --mult, so once it's seen the values aren't multiplied.
+    Reduction::Accumulator accumulator(threads, opt.sum);
 
     ArgumentParser::ArgParser parser("Program");
-    parser.AddIntArgument("N").MultiValue(1).Positional().StoreValues(values);
+    parser.AddIntArgument("N").MultiValue(1).Positional().StoreTo([&accumulator](const int& value) {
+        accumulator.Add(value);
+    });
+    parser.AddIntArgument("threads", "worker threads, 0 for one per core").Default(0).StoreValue(threads);
+    std::string completion;
+    std::string completion_output;
+    parser.AddArgument<std::string>("completion", "print a bash or zsh completion script").Optional().StoreValue(completion);
+    parser.AddArgument<std::string>("completion-output", "write the completion script to this file instead")
+        .Optional().StoreValue(completion_output);
     parser.AddFlag("sum", "add args").StoreValue(opt.sum);
     parser.AddFlag("mult", "multiply args").StoreValue(opt.mult);
     parser.AddHelp('h', "help", "Program accumulate arguments");
 
-    if(!parser.Parse(argc, argv)) {
+    bool correct = parser.Parse(argc, argv);
+    if(parser.Has("completion")) {
+        std::string script;
+        try {
+            script = parser.GenerateCompletion(completion, "labwork5");
+        } catch (const settings_exception& error) {
+            std::cerr << error.what() << ", expected bash or zsh" << std::endl;
+            return 1;
+        }
+        if(!parser.Has("completion-output")) {
+            std::cout << script;
+            return 0;
+        }
+        std::ofstream output(completion_output);
+        if(!(output << script)) {
+            std::cerr << "Can't write [" << completion_output << "]" << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    if(!correct) {
         std::cout << "Wrong argument" << std::endl;
         std::cout << parser.HelpDescription() << std::endl;
         return 1;
@@ -32,10 +63,18 @@ int main(int argc, char** argv) {
         return 0;
     }
 
-    if(opt.sum) {
-        std::cout << "Result: " << std::accumulate(values.begin(), values.end(), 0) << std::endl;
-    } else if(opt.mult) {
-        std::cout << "Result: " << std::accumulate(values.begin(), values.end(), 1, std::multiplies<int>()) << std::endl;
+    if(threads < 0) {
+        std::cout << "Number of threads can't be negative" << std::endl;
+        return 1;
+    }
+
+    if(opt.sum || opt.mult) {
+        Reduction::Result result = opt.sum ? accumulator.Sum() : accumulator.Product();
+        if(result.overflow) {
+            std::cout << "Result doesn't fit in 64 bits" << std::endl;
+            return 1;
+        }
+        std::cout << "Result: " << result.value << std::endl;
     } else {
         std::cout << "No one options had chosen" << std::endl;
         std::cout << parser.HelpDescription();
@@ -1,294 +1,1595 @@
 #include "ArgParser.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+
+#include "ConfigSource.h"
+#include "IntegerParsing.h"
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
 namespace ArgumentParser {
 
-    bool ArgParser::CheckCorrectness() const {
-        auto check_correctness = []<typename K>(const std::map<std::string, std::shared_ptr<Argument<K>>>& arguments) {
-            return std::all_of(arguments.begin(), arguments.end(), [](std::pair<std::string, std::shared_ptr<Argument<K>>> pair){
-                return pair.second->IsCorrect();
-            });
-        };
-        return check_correctness(int_arguments_) && check_correctness(string_arguments_);
+    namespace {
+        constexpr size_t kIntegerBatchSize = 256;
+
+        // Keys named in an ambiguity error.
+        constexpr size_t kListedCandidates = 5;
+
+        ParseErrorCode IntegerErrorCode(IntegerStatus status) {
+            return status == IntegerStatus::kOutOfRange ? ParseErrorCode::kValueOutOfRange : ParseErrorCode::kNotAnInteger;
+        }
+
+        bool IsPositionalToken(std::string_view token) {
+            return token.size() < 2 || token[0] != '-';
+        }
     }
 
-    void ArgParser::UpdatePositionalArgument(const std::string& value) {
-        for (const auto& key : keys_) {
-            if (key.second->type == StoreType::kIntArgument) {
-                const auto& argument = int_arguments_[key.first];
-                if (argument->positional_) {
-                    argument->SetValue(std::stoi(value));
+    // Collects ParseStats for one parse. Without ARGPARSER_INSTRUMENTATION
+    // every method is empty and the calls compile away.
+    class StatsRecorder {
+     private:
+        using Clock = std::chrono::steady_clock;
+
+        ParseStats* stats_;
+        const StatsCallback* callback_;
+     public:
+        StatsRecorder(ParseStats* stats, const StatsCallback* callback) : stats_(stats), callback_(callback) {}
+
+        void Token(uint64_t ParseStats::* form, uint64_t count = 1) {
+            if constexpr (kInstrumentation) {
+                stats_->*form += count;
+            }
+        }
+
+        void Lookup(bool found) {
+            if constexpr (kInstrumentation) {
+                stats_->lookups++;
+                stats_->lookup_misses += !found;
+            }
+        }
+
+        void Allocations(uint64_t count) {
+            if constexpr (kInstrumentation) {
+                stats_->allocations += count;
+            }
+        }
+
+        // Runs body and counts a reallocation of container if it happened.
+        template<typename Container, typename Body>
+        void Growth(const Container& container, Body&& body) {
+            if constexpr (kInstrumentation) {
+                size_t capacity = container.capacity();
+                body();
+                stats_->allocations += container.capacity() != capacity;
+            } else {
+                body();
+            }
+        }
+
+        template<typename Body>
+        decltype(auto) Time(std::chrono::nanoseconds ParseStats::* phase, Body&& body) {
+            if constexpr (kInstrumentation) {
+                auto start = Clock::now();
+                struct Stop {
+                    std::chrono::nanoseconds& phase;
+                    Clock::time_point start;
+                    ~Stop() {
+                        phase += Clock::now() - start;
+                    }
+                } stop{stats_->*phase, start};
+                return body();
+            } else {
+                return body();
+            }
+        }
+
+        // Runs one step of a parse: the time not spent converting or checking
+        // goes to tokenize, an exception is counted and reported before it
+        // leaves.
+        template<typename Body>
+        decltype(auto) Track(Body&& body) {
+            if constexpr (kInstrumentation) {
+                auto nested = stats_->convert + stats_->check_correctness;
+                auto start = Clock::now();
+                struct Stop {
+                    ParseStats& stats;
+                    std::chrono::nanoseconds nested;
+                    Clock::time_point start;
+                    ~Stop() {
+                        stats.tokenize += Clock::now() - start - (stats.convert + stats.check_correctness - nested);
+                    }
+                } stop{*stats_, nested, start};
+                try {
+                    return body();
+                } catch (...) {
+                    stats_->exceptions++;
+                    Report();
+                    throw;
                 }
-            } else if (key.second->type == StoreType::kStringArgument) {
-                const auto& argument = string_arguments_[key.first];
-                if (argument->positional_) {
-                    argument->SetValue(value);
+            } else {
+                return body();
+            }
+        }
+
+        void Report() const {
+            if constexpr (kInstrumentation) {
+                if (*callback_) {
+                    (*callback_)(*stats_);
                 }
             }
         }
+    };
+
+    ArgParser::ArgParser(std::string name) : name_(std::move(name)) {}
+
+    ArgParser::ArgParser(std::string name, size_t expected_options)
+        : name_(std::move(name))
+        , arena_(expected_options * (sizeof(Key) + sizeof(Argument<std::string>)
+                                     + sizeof(std::pmr::vector<std::string>) + sizeof(std::string) + 64)) {}
+
+    ArgParser::~ArgParser() {
+        for (ArgumentBase* argument : value_arguments_) {
+            argument->~ArgumentBase();
+        }
     }
 
-    void ArgParser::UpdateShortFlags(const std::string& raw_key) {
-        for (int i = 1; i < raw_key.length(); i++) {
-            if (std::string{raw_key[i]} == help_->short_key) {
-                found_help_ = true;
-            } else {
-                *flags_[{raw_key[i]}]->value_ = true;
-            }
+    void ArgumentBase::Changed(bool layout) const {
+        if (parser_ != nullptr) {
+            parser_->SchemaChanged(layout);
+        }
+    }
+
+    std::pmr::memory_resource* ArgumentBase::Arena() const {
+        return parser_ != nullptr ? &parser_->arena_ : std::pmr::get_default_resource();
+    }
+
+    void Flag::Changed() const {
+        if (parser_ != nullptr) {
+            parser_->SchemaChanged(false);
+        }
+    }
+
+    void ArgParser::SchemaChanged(bool layout) {
+        help_text_.clear();
+        if (layout) {
+            frozen_ = false;
+        }
+    }
+
+    bool ArgParser::CheckCorrectness() const {
+        auto check_correctness = []<typename K>(const std::pmr::deque<Argument<K>>& arguments) {
+            return std::all_of(arguments.begin(), arguments.end(), [](const Argument<K>& argument) {
+                return argument.IsCorrect();
+            });
+        };
+        return check_correctness(int_arguments_) && check_correctness(string_arguments_)
+            && std::all_of(value_arguments_.begin(), value_arguments_.end(), [](const ArgumentBase* argument) {
+                return argument->IsCorrect(argument->number_of_values_);
+            })
+            && (selected_subcommand_ == kNoSubcommand || subcommands_[selected_subcommand_].parser->CheckCorrectness());
+    }
+
+    const KeySlot& ArgParser::FindKey(std::string_view key) const {
+        const KeySlot* slot = table_.Find(key);
+        if (slot == nullptr) {
+            throw parse_exception("There's no such argument as [" + std::string(key) + "]");
         }
+        return *slot;
     }
 
-    void ArgParser::UpdateFlag(const std::string& raw_key) {
-        std::string long_key = raw_key.substr(2);
-        if (help_->long_key == long_key) {
-            found_help_ = true;
+    const KeySlot& ArgParser::FindTypedKey(std::string_view key, StoreType type) {
+        if (!frozen_) {
+            Freeze();
+        }
+        const KeySlot& slot = FindKey(key);
+        if (slot.type != type) {
+            throw parse_exception("Key [" + std::string(key) + "] has another type");
+        }
+        if (slot.index < raw_values_.size() && !raw_values_[slot.index].empty()) {
+            ConvertRaw(slot.index);
+        }
+        return slot;
+    }
+
+    void ArgParser::ConvertRaw(uint32_t key_index) const {
+        // A value that doesn't convert stays raw, so every read throws.
+        std::vector<std::string_view>& raw = raw_values_[key_index];
+        const Key& key = keys_[key_index];
+        auto fail = [&key](ParseErrorCode code, std::string_view value) {
+            std::string_view name = key.long_key.empty() ? key.short_key : key.long_key;
+            ParseError error{
+                .code = code,
+                .token_index = 0,
+                .key = std::string(name),
+                .value = std::string(value),
+                .source = "first read",
+                .suggestion = {},
+            };
+            throw parse_exception(error.Message());
+        };
+        if (key.type == kIntArgument) {
+            std::vector<int> values(raw.size());
+            IntegerStatus status;
+            size_t converted = ParseIntegers(raw.data(), raw.size(), values.data(), status);
+            if (converted != raw.size()) {
+                fail(IntegerErrorCode(status), raw[converted]);
+            }
+            key.int_argument->number_of_values_ -= raw.size();
+            key.int_argument->SetValues(values);
         } else {
-            *flags_[raw_key.substr(2)]->value_ = true;
+            key.string_argument->number_of_values_ -= raw.size();
+            for (std::string_view value : raw) {
+                key.string_argument->SetValue(std::string(value));
+            }
         }
+        raw.clear();
     }
 
-    void ArgParser::SetArgument(const std::string& argument_name, const std::string& value) {
-        try {
-            const auto& key = keys_.at(argument_name);
-            if (key->type == StoreType::kIntArgument) {
-                int_arguments_[argument_name]->SetValue(std::stoi(value));
+    void ArgParser::Freeze() {
+#ifdef ARGPARSER_INSTRUMENTATION
+        auto start = std::chrono::steady_clock::now();
+#endif
+        std::vector<KeySlot> entries;
+        entries.reserve(keys_.size() * 2 + 2);
+        if (help_ != std::nullopt) {
+            for (const std::pmr::string* help_key : {&help_->short_key, &help_->long_key}) {
+                if (!help_key->empty()) {
+                    KeySlot slot;
+                    slot.name = *help_key;
+                    slot.type = kHelpArgument;
+                    entries.push_back(slot);
+                }
+            }
+        }
+        positionals_.clear();
+        uint32_t index = 0;
+        for (const Key& key : keys_) {
+            KeySlot slot;
+            slot.type = key.type;
+            slot.index = index++;
+            slot.flag = key.flag;
+            for (const std::pmr::string* name : {&key.short_key, &key.long_key}) {
+                if (name->empty() || (help_ != std::nullopt && (*name == help_->short_key || *name == help_->long_key))) {
+                    continue;
+                }
+                slot.name = *name;
+                entries.push_back(slot);
+            }
+
+            PositionalSlot positional;
+            positional.slot = slot;
+            positional.slot.name = key.long_key;
+            if (key.type == kIntArgument && key.int_argument->positional_) {
+                positional.multi_value = key.int_argument->multi_value_;
+            } else if (key.type == kStringArgument && key.string_argument->positional_) {
+                positional.multi_value = key.string_argument->multi_value_;
+            } else if (key.type == kValueArgument && key.argument->positional_) {
+                positional.multi_value = key.argument->multi_value_;
             } else {
-                string_arguments_[argument_name]->SetValue(value);
+                continue;
             }
-        } catch (const std::exception& exception) {
-            throw parse_exception("There's no such argument as [" + argument_name + "]");
+            positionals_.push_back(positional);
         }
+        if (!table_.Build(entries)) {
+            std::vector<std::string_view> names;
+            for (const KeySlot& entry : entries) {
+                names.push_back(entry.name);
+            }
+            std::sort(names.begin(), names.end());
+            auto duplicate = std::adjacent_find(names.begin(), names.end());
+            if (duplicate != names.end()) {
+                throw settings_exception("Key [" + std::string(*duplicate) + "] is registered more than once");
+            }
+            throw settings_exception("Failed to build key table");
+        }
+        prefixes_.Build(entries);
+        short_keys_.fill(nullptr);
+        for (const KeySlot& entry : entries) {
+            if (entry.name.size() == 1) {
+                short_keys_[static_cast<unsigned char>(entry.name[0])] = table_.Find(entry.name);
+            }
+        }
+        frozen_ = true;
+        help_text_.clear();
+#ifdef ARGPARSER_INSTRUMENTATION
+        stats_.schema_build = std::chrono::steady_clock::now() - start;
+#endif
     }
 
-    void ArgParser::UpdateArgument(const std::string& equation) {
-        SetArgument(
-            {equation.begin() + (equation[1] == '-') + 1, equation.begin() + equation.find('=')},
-            {equation.begin() + equation.find('=') + 1, equation.end()}
-        );
+    StatsRecorder ArgParser::RecordStats() {
+#ifdef ARGPARSER_INSTRUMENTATION
+        stats_ = ParseStats{.schema_build = stats_.schema_build};
+        return {&stats_, &stats_callback_};
+#else
+        return {nullptr, nullptr};
+#endif
     }
 
-    void ArgParser::UpdateArgument(const std::string& raw_argument_name, const std::string& value) {
-        SetArgument(
-            raw_argument_name.substr(1 + (raw_argument_name[1] == '-')),
-            value
-        );
+    StatsRecorder ArgParser::RecordStats([[maybe_unused]] ParseResult& result) const {
+#ifdef ARGPARSER_INSTRUMENTATION
+        result.stats_.schema_build = stats_.schema_build;
+        return {&result.stats_, &stats_callback_};
+#else
+        return {nullptr, nullptr};
+#endif
     }
 
-    bool ArgParser::Parse(const std::vector<std::string>& data) {
-        for (int i = 1; i < data.size(); i++) {
-            if (data[i][0] == '-') {
-                if (data[i].find('=') != std::string::npos) {
-                    UpdateArgument(data[i]);
-                } else if (data[i][1] != '-') {
-                    if (data[i].length() > 2) {
-                        UpdateShortFlags(data[i]);
-                    } else {
-                        switch (keys_.at(data[i].substr(1))->type) {
-                            case kIntArgument:
-                            case kStringArgument:
-                                if (i == data.size() - 1) {
-                                    throw parse_exception("Not enough values");
-                                }
-                                UpdateArgument(data[i], data[i + 1]);
-                                i++;
-                                break;
-                            case kFlagArgument:UpdateShortFlags(data[i]);
-                                break;
-                        }
-                    }
+    const ParseStats& ArgParser::Stats() const {
+#ifdef ARGPARSER_INSTRUMENTATION
+        return stats_;
+#else
+        static const ParseStats kEmpty;
+        return kEmpty;
+#endif
+    }
+
+    void ArgParser::SetStatsCallback([[maybe_unused]] StatsCallback callback) {
+#ifdef ARGPARSER_INSTRUMENTATION
+        stats_callback_ = std::move(callback);
+#endif
+    }
+
+    // Writes parsed values straight into the registered Argument and Flag objects.
+    class SchemaTarget {
+     private:
+        ArgParser& parser_;
+        StatsRecorder& stats_;
+        // Set when the tokens don't outlive the parse, SetRaw copies them.
+        bool copy_tokens_;
+     public:
+        SchemaTarget(ArgParser& parser, StatsRecorder& stats, bool copy_tokens = false)
+            : parser_(parser), stats_(stats), copy_tokens_(copy_tokens) {}
+
+        [[nodiscard]] uint64_t Count(const KeySlot& slot) const {
+            switch (slot.type) {
+                case kIntArgument:return slot.int_argument->number_of_values_;
+                case kStringArgument:return slot.string_argument->number_of_values_;
+                case kFlagArgument:return slot.flag->times_set_;
+                default:return slot.argument->number_of_values_;
+            }
+        }
+
+        // Only a multi-value argument has a vector that can grow.
+        template<typename T, typename Body>
+        void Store(Argument<T>& argument, Body&& body) {
+            if (argument.multi_value_ && !argument.streamed_) {
+                stats_.Growth(*argument.values_, body);
+            } else {
+                body();
+            }
+        }
+
+        [[nodiscard]] bool Lazy(const KeySlot& slot) const {
+            return parser_.lazy_ && (slot.type == kIntArgument ? !slot.int_argument->Redirected()
+                                   : slot.type == kStringArgument && !slot.string_argument->Redirected());
+        }
+
+        void SetRaw(const KeySlot& slot, std::string_view value) {
+            ArgumentBase& argument = slot.type == kIntArgument ? static_cast<ArgumentBase&>(*slot.int_argument)
+                                                               : *slot.string_argument;
+            if (parser_.raw_values_.size() <= slot.index) {
+                parser_.raw_values_.resize(parser_.keys_.size());
+            }
+            std::vector<std::string_view>& raw = parser_.raw_values_[slot.index];
+            if (!argument.multi_value_) {
+                raw.clear();
+            }
+            raw.push_back(copy_tokens_ ? parser_.copied_tokens_.emplace_front(value) : value);
+            argument.number_of_values_++;
+        }
+
+        void SetInt(const KeySlot& slot, int value) {
+            SetInts(slot, {&value, 1});
+        }
+
+        void SetInts(const KeySlot& slot, std::span<const int> values) {
+            Argument<int>& argument = *slot.int_argument;
+            Store(argument, [&] {
+                argument.SetValues(values);
+            });
+        }
+
+        void SetString(const KeySlot& slot, std::string_view value) {
+            Argument<std::string>& argument = *slot.string_argument;
+            stats_.Allocations(value.size() > std::string().capacity());
+            Store(argument, [&] {
+                argument.SetValue(std::string(value));
+            });
+        }
+
+        [[nodiscard]] bool SetValue(const KeySlot& slot, std::string_view value) {
+            return slot.argument->Store(value);
+        }
+
+        void SetFlag(const KeySlot& slot, bool value = true) {
+            *slot.flag->value_ = value;
+            slot.flag->times_set_++;
+        }
+
+        void SetHelp() {
+            parser_.found_help_ = true;
+        }
+
+        ArgParser& EnterSubcommand(size_t index) {
+            return parser_.EnterSubcommand(index);
+        }
+    };
+
+    // Collects parsed values into a ParseResult, the schema is only read.
+    class ResultTarget {
+     private:
+        ParseResult& result_;
+        StatsRecorder& stats_;
+
+        ParseResult::Entry& Entry(const KeySlot& slot) {
+            ParseResult::Entry* entry = nullptr;
+            bool indexed = !result_.index_.empty();
+            stats_.Growth(result_.entries_, [&] {
+                entry = &result_.Add(slot.index);
+            });
+            stats_.Allocations(!indexed && !result_.index_.empty());
+            return *entry;
+        }
+     public:
+        ResultTarget(ParseResult& result, StatsRecorder& stats) : result_(result), stats_(stats) {}
+
+        [[nodiscard]] uint64_t Count(const KeySlot& slot) const {
+            return result_.Count(slot.index);
+        }
+
+        [[nodiscard]] static bool Lazy(const KeySlot&) {
+            return false;
+        }
+
+        static void SetRaw(const KeySlot&, std::string_view) {}
+
+        void SetInt(const KeySlot& slot, int value) {
+            SetInts(slot, {&value, 1});
+        }
+
+        void SetInts(const KeySlot& slot, std::span<const int> values) {
+            ParseResult::Entry& entry = Entry(slot);
+            std::vector<int>& stored = entry.int_values;
+            stats_.Growth(stored, [&] {
+                if (slot.int_argument->multi_value_) {
+                    stored.insert(stored.end(), values.begin(), values.end());
                 } else {
-                    if (data[i].substr(2) == help_->long_key) {
-                        found_help_ = true;
-                        continue;
+                    stored.assign(1, values.back());
+                }
+            });
+            entry.count += values.size();
+        }
+
+        void SetString(const KeySlot& slot, std::string_view value) {
+            ParseResult::Entry& entry = Entry(slot);
+            std::vector<std::string>& stored = entry.string_values;
+            if (!slot.string_argument->multi_value_) {
+                stored.clear();
+            }
+            stats_.Allocations(value.size() > std::string().capacity());
+            stats_.Growth(stored, [&] {
+                stored.emplace_back(value);
+            });
+            entry.count++;
+        }
+
+        // Only the token is kept, ParseResult converts it again on reads.
+        [[nodiscard]] bool SetValue(const KeySlot& slot, std::string_view value) {
+            if (!slot.argument->Accepts(value)) {
+                return false;
+            }
+            ParseResult::Entry& entry = Entry(slot);
+            std::vector<std::string>& stored = entry.string_values;
+            if (!slot.argument->multi_value_) {
+                stored.clear();
+            }
+            stored.emplace_back(value);
+            entry.count++;
+            return true;
+        }
+
+        void SetFlag(const KeySlot& slot, bool value = true) {
+            ParseResult::Entry& entry = Entry(slot);
+            entry.count++;
+            entry.flag = value;
+        }
+
+        void SetHelp() {
+            result_.found_help_ = true;
+        }
+
+        ArgParser& EnterSubcommand(size_t) {
+            throw settings_exception("Subcommands can't be parsed into a ParseResult");
+        }
+    };
+
+    // One pass of the parse state machine over a token range. The schema is
+    // read-only here, every write goes through Target.
+    template<typename Target>
+    class ParseRun {
+     private:
+        const ArgParser& parser_;
+        Target& target_;
+        StatsRecorder& stats_;
+        ArgParser* subcommand_ = nullptr;
+        const KeySlot* pending_ = nullptr;
+        size_t positional_cursor_ = 0;
+        size_t token_index_ = 0;
+        // Where values come from once argv is over, empty while reading argv.
+        std::string source_;
+        ParseError error_;
+
+        bool Fail(ParseErrorCode code, std::string_view key, std::string_view value, size_t token_index) {
+            error_ = ParseError{
+                .code = code,
+                .token_index = source_.empty() ? token_index : 0,
+                .key = std::string(key),
+                .value = std::string(value),
+                .source = source_,
+                .suggestion = {},
+            };
+            return false;
+        }
+
+        template<typename T>
+        bool Forward(const std::expected<T, ParseError>& result) {
+            if (!result) {
+                error_ = result.error();
+                return false;
+            }
+            return true;
+        }
+
+        // A long key may be abbreviated to any prefix that only one key has.
+        const KeySlot* FindKey(std::string_view key, bool long_key) {
+            const KeySlot* slot = key.size() == 1 ? parser_.short_keys_[static_cast<unsigned char>(key[0])]
+                                                  : parser_.table_.Find(key);
+            if (slot == nullptr && long_key && !key.empty()) {
+                std::span<const KeySlot> matches = parser_.prefixes_.Matches(key);
+                if (matches.size() == 1) {
+                    slot = &matches[0];
+                } else if (matches.size() > 1) {
+                    stats_.Lookup(false);
+                    std::string candidates;
+                    for (size_t i = 0; i < std::min(matches.size(), kListedCandidates); i++) {
+                        candidates += (i == 0 ? "" : ", ") + std::string(matches[i].name);
                     }
-                    switch (keys_.at(data[i].substr(2))->type) {
-                        case kIntArgument:
-                        case kStringArgument:
-                            if (i == data.size() - 1) {
-                                throw parse_exception("Not enough values");
-                            }
-                            UpdateArgument(data[i], data[i + 1]);
-                            i++;
-                            break;
-                        case kFlagArgument:UpdateFlag(data[i]);
-                            break;
+                    if (matches.size() > kListedCandidates) {
+                        candidates += ", ...";
                     }
+                    Fail(ParseErrorCode::kAmbiguousKey, key, candidates, token_index_);
+                    return nullptr;
+                }
+            }
+            stats_.Lookup(slot != nullptr);
+            if (slot == nullptr) {
+                Fail(ParseErrorCode::kUnknownKey, key, "", token_index_);
+                if (const KeySlot* closest = parser_.prefixes_.Closest(key)) {
+                    error_.suggestion = closest->name;
+                }
+            }
+            return slot;
+        }
+
+        const KeySlot* NextPositional() {
+            const auto& positionals = parser_.positionals_;
+            while (positional_cursor_ < positionals.size() && !positionals[positional_cursor_].multi_value
+                && target_.Count(positionals[positional_cursor_].slot) != 0) {
+                positional_cursor_++;
+            }
+            return positional_cursor_ == positionals.size() ? nullptr : &positionals[positional_cursor_].slot;
+        }
+
+        bool SetIntegers(const KeySlot& slot, const std::string_view* values, size_t count) {
+            int converted[kIntegerBatchSize];
+            IntegerStatus status;
+            size_t failed = stats_.Time(&ParseStats::convert, [&] {
+                return ParseIntegers(values, count, converted, status);
+            });
+            if (failed != count) {
+                return Fail(IntegerErrorCode(status), slot.name, values[failed], token_index_ - count + 1 + failed);
+            }
+            target_.SetInts(slot, {converted, count});
+            return true;
+        }
+
+        bool EnterSubcommand(std::string_view token) {
+            if (parser_.subcommands_.empty()) {
+                return false;
+            }
+            size_t index = parser_.FindSubcommand(token);
+            if (index == ArgParser::kNoSubcommand) {
+                return false;
+            }
+            subcommand_ = &target_.EnterSubcommand(index);
+            return true;
+        }
+
+        void UpdateFlag(const KeySlot& slot) {
+            if (slot.type == kHelpArgument) {
+                target_.SetHelp();
+            } else {
+                target_.SetFlag(slot);
+            }
+        }
+
+        bool UpdateShortFlags(std::string_view raw_key) {
+            for (size_t i = 1; i < raw_key.length(); i++) {
+                const KeySlot* slot = parser_.short_keys_[static_cast<unsigned char>(raw_key[i])];
+                stats_.Lookup(slot != nullptr);
+                if (slot == nullptr) {
+                    return Fail(ParseErrorCode::kUnknownKey, raw_key.substr(i, 1), raw_key, token_index_);
+                }
+                if (slot->type != kFlagArgument && slot->type != kHelpArgument) {
+                    return Fail(ParseErrorCode::kNotAFlag, raw_key.substr(i, 1), raw_key, token_index_);
+                }
+                UpdateFlag(*slot);
+            }
+            return true;
+        }
+
+        bool SetArgument(const KeySlot& slot, std::string_view value) {
+            if (slot.type == kFlagArgument || slot.type == kHelpArgument) {
+                return Fail(ParseErrorCode::kFlagWithValue, slot.name, value, token_index_);
+            }
+            // Fallback values are converted right away, getenv's don't last.
+            if (source_.empty() && target_.Lazy(slot)) {
+                target_.SetRaw(slot, value);
+                return true;
+            }
+            if (slot.type == kIntArgument) {
+                int converted;
+                IntegerStatus status = stats_.Time(&ParseStats::convert, [&] {
+                    return ParseInteger(value, converted);
+                });
+                if (status != IntegerStatus::kOk) {
+                    return Fail(IntegerErrorCode(status), slot.name, value, token_index_);
                 }
+                target_.SetInt(slot, converted);
+            } else if (slot.type == kStringArgument) {
+                target_.SetString(slot, value);
             } else {
-                UpdatePositionalArgument(data[i]);
+                bool converted = stats_.Time(&ParseStats::convert, [&] {
+                    return target_.SetValue(slot, value);
+                });
+                if (!converted) {
+                    return Fail(ParseErrorCode::kInvalidValue, slot.name, value, token_index_);
+                }
             }
+            return true;
+        }
+
+        bool UpdateArgument(std::string_view equation) {
+            size_t equal_sign = equation.find('=');
+            size_t name_begin = (equation[1] == '-') + 1;
+            const KeySlot* slot = FindKey(equation.substr(name_begin, equal_sign - name_begin), name_begin == 2);
+            return slot != nullptr && SetArgument(*slot, equation.substr(equal_sign + 1));
         }
 
-        return CheckCorrectness();
+        static const ArgumentBase& Base(const KeySlot& slot) {
+            return slot.type == kIntArgument ? *slot.int_argument
+                 : slot.type == kStringArgument ? *slot.string_argument
+                                                : *slot.argument;
+        }
+
+        bool SetFallback(const KeySlot& slot, std::string_view value, bool split) {
+            if (slot.type == kFlagArgument) {
+                bool on = value.empty() || value == "1" || value == "true" || value == "yes" || value == "on";
+                if (!on && value != "0" && value != "false" && value != "no" && value != "off") {
+                    return Fail(ParseErrorCode::kInvalidValue, slot.name, value, 0);
+                }
+                target_.SetFlag(slot, on);
+                return true;
+            }
+            if (!split || !Base(slot).multi_value_) {
+                return SetArgument(slot, value);
+            }
+            constexpr std::string_view kSpaces = " \t\r\n";
+            for (size_t begin = value.find_first_not_of(kSpaces); begin != std::string_view::npos;) {
+                size_t end = std::min(value.find_first_of(kSpaces, begin), value.size());
+                if (!SetArgument(slot, value.substr(begin, end - begin))) {
+                    return false;
+                }
+                begin = value.find_first_not_of(kSpaces, end);
+            }
+            return true;
+        }
+
+        // Fills the options argv left out from the environment and then from
+        // the config file; an option is taken from one source only.
+        bool ApplyFallbacks() {
+            if (parser_.env_prefix_.empty() && parser_.config_file_ == nullptr) {
+                return true;
+            }
+            std::vector<KeySlot> slots;
+            std::vector<bool> given;
+            slots.reserve(parser_.keys_.size());
+            given.reserve(parser_.keys_.size());
+            for (const Key& key : parser_.keys_) {
+                KeySlot& slot = slots.emplace_back();
+                slot.name = key.long_key.empty() ? key.short_key : key.long_key;
+                slot.type = key.type;
+                slot.index = slots.size() - 1;
+                slot.flag = key.flag;
+                given.push_back(target_.Count(slot) != 0);
+            }
+            bool applied = true;
+            if (!parser_.env_prefix_.empty()) {
+                for (size_t i = 0; i < slots.size() && applied; i++) {
+                    const std::pmr::string& long_key = parser_.keys_[i].long_key;
+                    if (given[i] || long_key.empty()) {
+                        continue;
+                    }
+                    std::string name = EnvironmentName(parser_.env_prefix_, long_key);
+                    if (const char* value = std::getenv(name.c_str())) {
+                        source_ = "environment variable " + name;
+                        applied = SetFallback(slots[i], value, true);
+                        given[i] = true;
+                    }
+                }
+            }
+            if (applied && parser_.config_file_ != nullptr) {
+                source_ = "config file";
+                ForEachConfigEntry(parser_.config_file_->View(), [&](std::string_view key, std::string_view value) {
+                    const KeySlot* slot = parser_.table_.Find(key);
+                    if (applied && slot != nullptr && slot->type != kHelpArgument && !given[slot->index]) {
+                        applied = SetFallback(*slot, value, false);
+                    }
+                });
+            }
+            source_.clear();
+            return applied;
+        }
+     public:
+        ParseRun(const ArgParser& parser, Target& target, StatsRecorder& stats)
+            : parser_(parser), target_(target), stats_(stats) {}
+
+        // Set when Feed, Finish or Run return false.
+        [[nodiscard]] const ParseError& Error() const {
+            return error_;
+        }
+
+        // Handles one token; a key that needs a separate value leaves
+        // pending_ set until the next token arrives.
+        bool Feed(std::string_view token) {
+            token_index_++;
+            if (subcommand_ != nullptr) {
+                return Forward(subcommand_->FeedStream(token, false));
+            }
+            if (pending_ != nullptr) {
+                const KeySlot& slot = *pending_;
+                pending_ = nullptr;
+                stats_.Token(&ParseStats::value_tokens);
+                return SetArgument(slot, token);
+            }
+            if (IsPositionalToken(token)) {
+                stats_.Token(&ParseStats::positional_tokens);
+                if (EnterSubcommand(token)) {
+                    return true;
+                }
+                const KeySlot* slot = NextPositional();
+                if (slot == nullptr) {
+                    return Fail(ParseErrorCode::kUnexpectedPositional, "", token, token_index_);
+                }
+                return SetArgument(*slot, token);
+            }
+            if (token.find('=') != std::string_view::npos) {
+                stats_.Token(&ParseStats::equals_tokens);
+                return UpdateArgument(token);
+            }
+            size_t name_begin = (token[1] == '-') + 1;
+            stats_.Token(name_begin == 1 ? &ParseStats::short_tokens : &ParseStats::long_tokens);
+            if (name_begin == 1 && token.length() > 2) {
+                return UpdateShortFlags(token);
+            }
+            const KeySlot* slot = FindKey(token.substr(name_begin), name_begin == 2);
+            if (slot == nullptr) {
+                return false;
+            }
+            switch (slot->type) {
+                case kIntArgument:
+                case kStringArgument:
+                case kValueArgument:pending_ = slot;
+                    break;
+                case kFlagArgument:
+                case kHelpArgument:UpdateFlag(*slot);
+                    break;
+            }
+            return true;
+        }
+
+        bool Finish() {
+            if (subcommand_ != nullptr) {
+                if (!Forward(subcommand_->FinishStream(false))) {
+                    return false;
+                }
+            } else if (pending_ != nullptr) {
+                std::string_view name = pending_->name;
+                pending_ = nullptr;
+                return Fail(ParseErrorCode::kMissingValue, name, "", token_index_);
+            }
+            return ApplyFallbacks();
+        }
+
+        // Same as feeding every token, except that runs of positional values
+        // for a multi-value int argument are converted in batches.
+        template<typename Iterator>
+        bool Run(Iterator begin, Iterator end) {
+            for (auto it = begin; it != end; ++it) {
+                std::string_view token = *it;
+                if (pending_ != nullptr || !IsPositionalToken(token)) {
+                    if (!Feed(token)) {
+                        return false;
+                    }
+                    continue;
+                }
+                if (EnterSubcommand(token)) {
+                    token_index_++;
+                    stats_.Token(&ParseStats::positional_tokens);
+                    return Forward(subcommand_->RunTokens(std::next(it), end, false)) && ApplyFallbacks();
+                }
+                const KeySlot* slot = NextPositional();
+                if (slot == nullptr || slot->type != kIntArgument || !slot->int_argument->multi_value_
+                    || target_.Lazy(*slot)) {
+                    if (!Feed(token)) {
+                        return false;
+                    }
+                    continue;
+                }
+                std::string_view run[kIntegerBatchSize];
+                size_t run_size = 0;
+                run[run_size++] = token;
+                // A subcommand name ends the run, Feed would switch to it.
+                while (run_size < kIntegerBatchSize && std::next(it) != end && IsPositionalToken(*std::next(it))
+                    && parser_.FindSubcommand(*std::next(it)) == ArgParser::kNoSubcommand) {
+                    ++it;
+                    run[run_size++] = *it;
+                }
+                token_index_ += run_size;
+                stats_.Token(&ParseStats::positional_tokens, run_size);
+                if (!SetIntegers(*slot, run, run_size)) {
+                    return false;
+                }
+            }
+            return Finish();
+        }
+    };
+
+    struct ArgParser::Stream {
+        StatsRecorder stats;
+        SchemaTarget target;
+        ParseRun<SchemaTarget> run;
+
+        explicit Stream(ArgParser& parser)
+            : stats(parser.RecordStats()), target(parser, stats, true), run(parser, target, stats) {}
+    };
+
+    template<typename Iterator>
+    std::expected<bool, ParseError> ArgParser::RunTokens(Iterator begin, Iterator end, bool throw_errors) {
+        if (!frozen_) {
+            Freeze();
+        }
+        StatsRecorder stats = RecordStats();
+        // A vector of strings is often a temporary, lazy mode copies its tokens.
+        SchemaTarget target(*this, stats, std::is_same_v<std::iter_value_t<Iterator>, std::string>);
+        ParseRun<SchemaTarget> run(*this, target, stats);
+        std::expected<bool, ParseError> result = stats.Track([&]() -> std::expected<bool, ParseError> {
+            if (!run.Run(begin, end)) {
+                if (throw_errors) {
+                    throw parse_exception(run.Error().Message());
+                }
+                return std::unexpected(run.Error());
+            }
+            return stats.Time(&ParseStats::check_correctness, [this] {
+                return CheckCorrectness();
+            });
+        });
+        stats.Report();
+
+        return result;
+    }
+
+    template<typename Iterator>
+    bool ArgParser::ParseTokens(Iterator begin, Iterator end) {
+        return *RunTokens(begin, end, true);
+    }
+
+    template<typename Iterator>
+    std::expected<void, ParseError> ArgParser::TryParseTokens(Iterator begin, Iterator end) {
+        std::expected<bool, ParseError> result = RunTokens(begin, end, false);
+        if (!result) {
+            return std::unexpected(std::move(result.error()));
+        }
+        if (!*result) {
+            return std::unexpected(ParseError{
+                .code = ParseErrorCode::kRequirementsNotMet,
+                .token_index = 0,
+                .key = FirstIncorrectKey(),
+                .value = {},
+                .source = {},
+                .suggestion = {},
+            });
+        }
+        return {};
+    }
+
+    template<typename Iterator>
+    ParseResult ArgParser::ParseTokensToResult(Iterator begin, Iterator end) const {
+        if (!frozen_) {
+            throw settings_exception("Freeze() the parser before parsing into a ParseResult");
+        }
+        ParseResult result(*this);
+        StatsRecorder stats = RecordStats(result);
+        ResultTarget target(result, stats);
+        stats.Track([&] {
+            ParseRun<ResultTarget> run(*this, target, stats);
+            if (!run.Run(begin, end)) {
+                throw parse_exception(run.Error().Message());
+            }
+            result.correct_ = stats.Time(&ParseStats::check_correctness, [&result] {
+                return result.CheckCorrectness();
+            });
+        });
+        stats.Report();
+
+        return result;
+    }
+
+    // Without even a program name there are no tokens, but the fallback
+    // sources still apply, as in TryParse.
+    bool ArgParser::Parse(const std::vector<std::string>& data) {
+        return data.empty() ? ParseTokens(data.end(), data.end()) : ParseTokens(data.begin() + 1, data.end());
+    }
+
+    bool ArgParser::Parse(std::span<const std::string_view> data) {
+        return data.empty() ? ParseTokens(data.end(), data.end()) : ParseTokens(data.begin() + 1, data.end());
     }
 
     bool ArgParser::Parse(int argc, char** argv) {
-        std::vector<std::string> data(argc);
-        for (int i = 0; i < argc; i++) {
-            data[i] = std::string(argv[i]);
+        return argc < 1 ? ParseTokens(argv, argv) : ParseTokens(argv + 1, argv + argc);
+    }
+
+    std::expected<void, ParseError> ArgParser::TryParse(const std::vector<std::string>& data) {
+        return data.empty() ? TryParseTokens(data.end(), data.end()) : TryParseTokens(data.begin() + 1, data.end());
+    }
+
+    std::expected<void, ParseError> ArgParser::TryParse(std::span<const std::string_view> data) {
+        return data.empty() ? TryParseTokens(data.end(), data.end()) : TryParseTokens(data.begin() + 1, data.end());
+    }
+
+    std::expected<void, ParseError> ArgParser::TryParse(int argc, char** argv) {
+        return argc < 1 ? TryParseTokens(argv, argv) : TryParseTokens(argv + 1, argv + argc);
+    }
+
+    bool ArgParser::Parse(std::istream& input) {
+        std::string token;
+        while (input >> token) {
+            Feed(token);
         }
+        return Finish();
+    }
 
-        return Parse(data);
+    std::expected<void, ParseError> ArgParser::FeedStream(std::string_view token, bool throw_errors) {
+        if (stream_ == nullptr) {
+            if (!frozen_) {
+                Freeze();
+            }
+            stream_ = std::make_unique<Stream>(*this);
+        }
+        Stream& stream = *stream_;
+        return stream.stats.Track([&]() -> std::expected<void, ParseError> {
+            if (!stream.run.Feed(token)) {
+                if (throw_errors) {
+                    throw parse_exception(stream.run.Error().Message());
+                }
+                return std::unexpected(stream.run.Error());
+            }
+            return {};
+        });
     }
 
-    Flag& ArgParser::AddFlag(char short_flag, const std::string& long_flag) {
-        auto new_flag = std::make_shared<Flag>(Flag());
-        std::string short_flag_string{short_flag};
-        auto key = std::make_shared<Key>(Key{short_flag_string, long_flag, "", StoreType::kFlagArgument});
-        keys_[short_flag_string] = keys_[long_flag] = key;
-        flags_[short_flag_string] = flags_[long_flag] = new_flag;
+    std::expected<bool, ParseError> ArgParser::FinishStream(bool throw_errors) {
+        std::unique_ptr<Stream> stream = std::move(stream_);
+        if (stream == nullptr) {
+            return CheckCorrectness();
+        }
+        std::expected<bool, ParseError> result = stream->stats.Track([&]() -> std::expected<bool, ParseError> {
+            if (!stream->run.Finish()) {
+                if (throw_errors) {
+                    throw parse_exception(stream->run.Error().Message());
+                }
+                return std::unexpected(stream->run.Error());
+            }
+            return stream->stats.Time(&ParseStats::check_correctness, [this] {
+                return CheckCorrectness();
+            });
+        });
+        stream->stats.Report();
 
-        return *new_flag;
+        return result;
     }
 
-    Flag& ArgParser::AddFlag(const std::string& long_flag, const std::string& description) {
-        auto new_flag = std::make_shared<Flag>(Flag());
-        auto key = std::make_shared<Key>(Key{"", long_flag, description, StoreType::kFlagArgument});
-        keys_[long_flag] = key;
-        flags_[long_flag] = new_flag;
+    void ArgParser::Feed(std::string_view token) {
+        (void) FeedStream(token, true);
+    }
+
+    bool ArgParser::Finish() {
+        return *FinishStream(true);
+    }
+
+    std::string ArgParser::FirstIncorrectKey() const {
+        for (const Key& key : keys_) {
+            const ArgumentBase* argument = key.type == kIntArgument ? key.int_argument
+                                         : key.type == kStringArgument ? key.string_argument
+                                         : key.type == kValueArgument ? key.argument
+                                                                      : nullptr;
+            if (argument != nullptr && !argument->IsCorrect(argument->number_of_values_)) {
+                return std::string(key.long_key.empty() ? key.short_key : key.long_key);
+            }
+        }
+        if (selected_subcommand_ != kNoSubcommand) {
+            return subcommands_[selected_subcommand_].parser->FirstIncorrectKey();
+        }
+        return "";
+    }
+
+    std::string ParseError::Message() const {
+        std::string location = source.empty() ? "token " + std::to_string(token_index) : source;
+        switch (code) {
+            case ParseErrorCode::kUnknownKey:
+                if (!value.empty()) {
+                    return "Unknown flag [" + key + "] in [" + value + "]";
+                }
+                return "There's no such argument as [" + key + "]"
+                    + (suggestion.empty() ? "" : ", did you mean [" + suggestion + "]?");
+            case ParseErrorCode::kAmbiguousKey:return "Argument [" + key + "] is ambiguous: " + value;
+            case ParseErrorCode::kNotAFlag:return "Argument [" + key + "] in [" + value + "] isn't a flag";
+            case ParseErrorCode::kUnexpectedPositional:return "Unexpected positional argument [" + value + "]";
+            case ParseErrorCode::kNotAnInteger:
+                return "Value [" + value + "] of argument [" + key + "] is not an integer (" + location + ")";
+            case ParseErrorCode::kValueOutOfRange:
+                return "Value [" + value + "] of argument [" + key + "] is out of range (" + location + ")";
+            case ParseErrorCode::kInvalidValue:
+                return "Value [" + value + "] of argument [" + key + "] can't be converted (" + location + ")";
+            case ParseErrorCode::kFlagWithValue:return "Flag [" + key + "] doesn't take a value";
+            case ParseErrorCode::kMissingValue:return "Not enough values for argument [" + key + "]";
+            case ParseErrorCode::kRequirementsNotMet:return "Argument [" + key + "] didn't get enough values";
+        }
+        return "Parse error";
+    }
+
+    ParseResult ArgParser::ParseToResult(const std::vector<std::string>& data) const {
+        return data.empty() ? ParseTokensToResult(data.end(), data.end()) : ParseTokensToResult(data.begin() + 1, data.end());
+    }
+
+    ParseResult ArgParser::ParseToResult(std::span<const std::string_view> data) const {
+        return data.empty() ? ParseTokensToResult(data.end(), data.end()) : ParseTokensToResult(data.begin() + 1, data.end());
+    }
+
+    ParseResult ArgParser::ParseToResult(int argc, char** argv) const {
+        return argc < 1 ? ParseTokensToResult(argv, argv) : ParseTokensToResult(argv + 1, argv + argc);
+    }
+
+    ParseResult::ParseResult(const ArgParser& parser) : parser_(&parser) {}
+
+    size_t ParseResult::Position(uint32_t key_index) const {
+        if (!index_.empty()) {
+            return index_[key_index] == 0 ? entries_.size() : index_[key_index] - 1;
+        }
+        for (size_t i = 0; i < entries_.size(); i++) {
+            if (entries_[i].key_index == key_index) {
+                return i;
+            }
+        }
+        return entries_.size();
+    }
+
+    const ParseResult::Entry* ParseResult::Find(uint32_t key_index) const {
+        size_t position = Position(key_index);
+        return position == entries_.size() ? nullptr : &entries_[position];
+    }
+
+    ParseResult::Entry& ParseResult::Add(uint32_t key_index) {
+        size_t position = Position(key_index);
+        if (position != entries_.size()) {
+            return entries_[position];
+        }
+        Entry& entry = entries_.emplace_back();
+        entry.key_index = key_index;
+        if (!index_.empty()) {
+            index_[key_index] = entries_.size();
+        } else if (entries_.size() > kIndexedEntries) {
+            index_.resize(parser_->keys_.size());
+            for (size_t i = 0; i < entries_.size(); i++) {
+                index_[entries_[i].key_index] = i + 1;
+            }
+        }
+        return entry;
+    }
+
+    uint64_t ParseResult::Count(uint32_t key_index) const {
+        const Entry* entry = Find(key_index);
+        return entry == nullptr ? 0 : entry->count;
+    }
+
+    const KeySlot& ParseResult::FindTypedKey(std::string_view key, StoreType type) const {
+        const KeySlot& slot = parser_->FindKey(key);
+        if (slot.type != type) {
+            throw parse_exception("Key [" + std::string(key) + "] has another type");
+        }
+        return slot;
+    }
+
+    bool ParseResult::CheckCorrectness() const {
+        uint32_t index = 0;
+        for (const Key& key : parser_->keys_) {
+            if (key.type == kIntArgument && !key.int_argument->IsCorrect(Count(index))) {
+                return false;
+            }
+            if (key.type == kStringArgument && !key.string_argument->IsCorrect(Count(index))) {
+                return false;
+            }
+            if (key.type == kValueArgument && !key.argument->IsCorrect(Count(index))) {
+                return false;
+            }
+            index++;
+        }
+        return true;
+    }
+
+    bool ParseResult::IsCorrect() const {
+        return correct_;
+    }
+
+    bool ParseResult::Help() const {
+        return found_help_;
+    }
+
+    const ParseStats& ParseResult::Stats() const {
+#ifdef ARGPARSER_INSTRUMENTATION
+        return stats_;
+#else
+        return parser_->Stats();
+#endif
+    }
+
+    bool ParseResult::GetFlag(const std::string& flag) const {
+        const KeySlot& slot = FindTypedKey(flag, kFlagArgument);
+        const Entry* entry = Find(slot.index);
+        return entry != nullptr ? entry->flag : slot.flag->default_value_;
+    }
+
+    template<typename T>
+    const T& ParseResult::Value(const Argument<T>& argument, uint32_t key_index, size_t index) const {
+        const Entry* entry = Find(key_index);
+        if (entry != nullptr && !argument.UsesDefaults(entry->count)) {
+            if constexpr (std::is_same_v<T, int>) {
+                return entry->int_values[argument.multi_value_ ? index : 0];
+            } else {
+                return entry->string_values[argument.multi_value_ ? index : 0];
+            }
+        }
+        return argument.DefaultValue(index);
+    }
+
+    template<typename T>
+    std::span<const T> ParseResult::Values(const Argument<T>& argument, uint32_t key_index) const {
+        const Entry* entry = Find(key_index);
+        if (argument.UsesDefaults(entry == nullptr ? 0 : entry->count)) {
+            return argument.DefaultValues();
+        }
+        if (entry == nullptr) {
+            return {};
+        }
+        if constexpr (std::is_same_v<T, int>) {
+            return entry->int_values;
+        } else {
+            return entry->string_values;
+        }
+    }
+
+    int ParseResult::GetIntValue(const std::string& key, int index) const {
+        const KeySlot& slot = FindTypedKey(key, kIntArgument);
+        return Value(*slot.int_argument, slot.index, index);
+    }
+
+    std::string ParseResult::GetStringValue(const std::string& key, int index) const {
+        const KeySlot& slot = FindTypedKey(key, kStringArgument);
+        return Value(*slot.string_argument, slot.index, index);
+    }
+
+    std::string_view ParseResult::GetStringView(const std::string& key, int index) const {
+        const KeySlot& slot = FindTypedKey(key, kStringArgument);
+        return Value(*slot.string_argument, slot.index, index);
+    }
+
+    std::span<const int> ParseResult::GetIntValues(const std::string& key) const {
+        const KeySlot& slot = FindTypedKey(key, kIntArgument);
+        return Values(*slot.int_argument, slot.index);
+    }
+
+    std::span<const std::string> ParseResult::GetStringValues(const std::string& key) const {
+        const KeySlot& slot = FindTypedKey(key, kStringArgument);
+        return Values(*slot.string_argument, slot.index);
+    }
 
-        return *new_flag;
+    int ParseResult::Get(IntHandle handle, size_t index) const {
+        return Value(*parser_->keys_[handle.index_].int_argument, handle.index_, index);
+    }
+
+    const std::string& ParseResult::Get(StringHandle handle, size_t index) const {
+        return Value(*parser_->keys_[handle.index_].string_argument, handle.index_, index);
+    }
+
+    bool ParseResult::Get(FlagHandle handle) const {
+        const Entry* entry = Find(handle.index_);
+        return entry != nullptr ? entry->flag : parser_->keys_[handle.index_].flag->default_value_;
+    }
+
+    bool ParseResult::Has(const std::string& key) const {
+        const KeySlot& slot = parser_->FindKey(key);
+        return slot.type == kHelpArgument ? found_help_ : Count(slot.index) != 0;
+    }
+
+    void ArgParser::Reset() {
+        stream_.reset();
+        for (std::vector<std::string_view>& raw : raw_values_) {
+            raw.clear();
+        }
+        copied_tokens_.clear();
+        found_help_ = false;
+        if (selected_subcommand_ != kNoSubcommand) {
+            subcommands_[selected_subcommand_].parser->Reset();
+            selected_subcommand_ = kNoSubcommand;
+        }
+        for (Argument<int>& argument : int_arguments_) {
+            argument.Reset();
+        }
+        for (Argument<std::string>& argument : string_arguments_) {
+            argument.Reset();
+        }
+        for (ArgumentBase* argument : value_arguments_) {
+            argument->Reset();
+        }
+        for (Flag& flag : flags_) {
+            flag.Reset();
+        }
+    }
+
+    Key& ArgParser::RegisterKey(const std::string& short_key,
+                                const std::string& long_key,
+                                const std::string& description,
+                                StoreType type) {
+        frozen_ = false;
+        return keys_.emplace_back(Key{
+            std::pmr::string(short_key, &arena_),
+            std::pmr::string(long_key, &arena_),
+            std::pmr::string(description, &arena_),
+            type,
+            {}
+        });
+    }
+
+    template<typename T>
+    Argument<T>& ArgParser::RegisterArgument(std::pmr::deque<Argument<T>>& arguments,
+                                             StoreType type,
+                                             const std::string& short_key,
+                                             const std::string& long_key,
+                                             const std::string& description) {
+        Argument<T>& argument = arguments.emplace_back();
+        argument.key_index_ = keys_.size();
+        argument.parser_ = this;
+        Key& key = RegisterKey(short_key, long_key, description, type);
+        if constexpr (std::is_same_v<T, int>) {
+            key.int_argument = &argument;
+        } else {
+            key.string_argument = &argument;
+        }
+
+        return argument;
+    }
+
+    template Argument<int>& ArgParser::RegisterArgument(std::pmr::deque<Argument<int>>&,
+                                                        StoreType,
+                                                        const std::string&,
+                                                        const std::string&,
+                                                        const std::string&);
+
+    template Argument<std::string>& ArgParser::RegisterArgument(std::pmr::deque<Argument<std::string>>&,
+                                                                StoreType,
+                                                                const std::string&,
+                                                                const std::string&,
+                                                                const std::string&);
+
+    Flag& ArgParser::RegisterFlag(const std::string& short_flag,
+                                  const std::string& long_flag,
+                                  const std::string& description) {
+        Flag& flag = flags_.emplace_back();
+        flag.key_index_ = keys_.size();
+        flag.parser_ = this;
+        RegisterKey(short_flag, long_flag, description, kFlagArgument).flag = &flag;
+
+        return flag;
+    }
+
+    Flag& ArgParser::AddFlag(char short_flag, const std::string& long_flag) {
+        return RegisterFlag({short_flag}, long_flag, "");
+    }
+
+    Flag& ArgParser::AddFlag(const std::string& long_flag, const std::string& description) {
+        return RegisterFlag("", long_flag, description);
     }
 
     Flag& ArgParser::AddFlag(char short_flag,
                              const std::string& long_flag,
                              const std::string& description) {
-        auto new_flag = std::make_shared<Flag>(Flag());
-        std::string short_flag_string{short_flag};
-        auto key = std::make_shared<Key>(Key{short_flag_string, long_flag, description, StoreType::kFlagArgument});
-        keys_[short_flag_string] = keys_[long_flag] = key;
-        flags_[short_flag_string] = flags_[long_flag] = new_flag;
-
-        return *new_flag;
+        return RegisterFlag({short_flag}, long_flag, description);
     }
 
     void ArgParser::SetFlag(const std::string& flag) {
-        try {
-            *flags_.at(flag)->value_ = true;
-        } catch (const std::exception& exception) {
-            throw parse_exception("Not excepted flag: [" + flag + "]");
-        }
+        *FindTypedKey(flag, kFlagArgument).flag->value_ = true;
     }
 
     bool ArgParser::GetFlag(const std::string& flag) {
-        try {
-            return *flags_.at(flag)->value_;
-        } catch (const std::exception& exception) {
-            throw parse_exception("There's no such flag");
-        }
+        return *FindTypedKey(flag, kFlagArgument).flag->value_;
     }
 
     Argument<int>& ArgParser::AddIntArgument(const std::string& long_key) {
-        auto argument = std::make_shared<Argument<int>>();
-        int_arguments_[long_key] = argument;
-        keys_[long_key] = std::make_shared<Key>(Key{"", long_key, "", StoreType::kIntArgument});
-
-        return *argument;
+        return RegisterArgument(int_arguments_, kIntArgument, "", long_key, "");
     }
 
     Argument<int>& ArgParser::AddIntArgument(char short_key, const std::string& long_key) {
-        auto argument = std::make_shared<Argument<int>>();
-        std::string short_key_string{short_key};
-        int_arguments_[short_key_string] = int_arguments_[long_key] = argument;
-        keys_[short_key_string] = keys_[long_key] =
-            std::make_shared<Key>(Key{short_key_string, long_key, "", StoreType::kIntArgument});
-
-        return *argument;
+        return RegisterArgument(int_arguments_, kIntArgument, {short_key}, long_key, "");
     }
 
     Argument<int>& ArgParser::AddIntArgument(const std::string& long_key, const std::string& description) {
-        auto argument = std::make_shared<Argument<int>>();
-        int_arguments_[long_key] = argument;
-        keys_[long_key] = std::make_shared<Key>(Key{"", long_key, description, StoreType::kIntArgument});
-
-        return *argument;
+        return RegisterArgument(int_arguments_, kIntArgument, "", long_key, description);
     }
 
     Argument<std::string>& ArgParser::AddStringArgument(const std::string& long_key) {
-        auto argument = std::make_shared<Argument<std::string>>();
-        string_arguments_[long_key] = argument;
-        keys_[long_key] = std::make_shared<Key>(Key{"", long_key, "", StoreType::kStringArgument});
-
-        return *argument;
+        return RegisterArgument(string_arguments_, kStringArgument, "", long_key, "");
     }
 
     Argument<std::string>& ArgParser::AddStringArgument(char short_key, const std::string& long_key) {
-        auto argument = std::make_shared<Argument<std::string>>();
-        std::string short_key_string{short_key};
-        string_arguments_[short_key_string] = string_arguments_[long_key] = argument;
-        keys_[short_key_string] = keys_[long_key] =
-            std::make_shared<Key>(Key{short_key_string, long_key, "", StoreType::kStringArgument});
-
-        return *argument;
+        return RegisterArgument(string_arguments_, kStringArgument, {short_key}, long_key, "");
     }
 
     Argument<std::string>& ArgParser::AddStringArgument(char short_key,
                                                         const std::string& long_key,
                                                         const std::string& description) {
-        auto argument = std::make_shared<Argument<std::string>>();
-        std::string short_key_string{short_key};
-        string_arguments_[short_key_string] = string_arguments_[long_key] = argument;
-        keys_[short_key_string] = keys_[long_key] =
-            std::make_shared<Key>(Key{short_key_string, long_key, description, StoreType::kStringArgument});
-
-        return *argument;
+        return RegisterArgument(string_arguments_, kStringArgument, {short_key}, long_key, description);
     }
 
     int ArgParser::GetIntValue(const std::string& key, int index) {
-        const auto& argument = int_arguments_.at(key);
-        if (argument->number_of_values_ >= argument->min_number_of_values_) {
-            if (argument->multi_value_) {
-                return (*argument->values_)[index];
-            }
-            return *argument->value_;
-        } else {
-            if (argument->multi_value_) {
-                return (*argument->default_values_)[index];
-            }
-            return *argument->default_value_;
-        }
+        return FindTypedKey(key, kIntArgument).int_argument->Value(index);
     }
 
     std::string ArgParser::GetStringValue(const std::string& key, int index) {
-        const auto& argument = string_arguments_.at(key);
-        if (argument->number_of_values_ >= argument->min_number_of_values_) {
-            if (argument->multi_value_) {
-                return (*argument->values_)[index];
-            }
-            return *argument->value_;
-        } else {
-            if (argument->multi_value_) {
-                return (*argument->default_values_)[index];
-            }
-            return *argument->default_value_;
+        return FindTypedKey(key, kStringArgument).string_argument->Value(index);
+    }
+
+    std::string_view ArgParser::GetStringView(const std::string& key, int index) {
+        return FindTypedKey(key, kStringArgument).string_argument->Value(index);
+    }
+
+    std::span<const int> ArgParser::GetIntValues(const std::string& key) {
+        return FindTypedKey(key, kIntArgument).int_argument->Values();
+    }
+
+    std::span<const std::string> ArgParser::GetStringValues(const std::string& key) {
+        return FindTypedKey(key, kStringArgument).string_argument->Values();
+    }
+
+    int ArgParser::Get(IntHandle handle, size_t index) const {
+        if (handle.index_ < raw_values_.size() && !raw_values_[handle.index_].empty()) {
+            ConvertRaw(handle.index_);
+        }
+        return keys_[handle.index_].int_argument->Value(index);
+    }
+
+    const std::string& ArgParser::Get(StringHandle handle, size_t index) const {
+        if (handle.index_ < raw_values_.size() && !raw_values_[handle.index_].empty()) {
+            ConvertRaw(handle.index_);
+        }
+        return keys_[handle.index_].string_argument->Value(index);
+    }
+
+    bool ArgParser::Get(FlagHandle handle) const {
+        return *keys_[handle.index_].flag->value_;
+    }
+
+    bool ArgParser::Has(const std::string& key) {
+        if (!frozen_) {
+            Freeze();
+        }
+        const KeySlot& slot = FindKey(key);
+        switch (slot.type) {
+            case kIntArgument:return slot.int_argument->number_of_values_ != 0;
+            case kStringArgument:return slot.string_argument->number_of_values_ != 0;
+            case kValueArgument:return slot.argument->number_of_values_ != 0;
+            case kFlagArgument:return slot.flag->times_set_ != 0;
+            default:return found_help_;
         }
     }
 
     void ArgParser::AddHelp(char short_key, const std::string& long_key, const std::string& description) {
-        help_ = {{short_key}, long_key, description};
+        help_ = Key{std::pmr::string(1, short_key), std::pmr::string(long_key), std::pmr::string(description), kHelpArgument, {}};
+        frozen_ = false;
+    }
+
+    void ArgParser::SetEnvPrefix(const std::string& prefix) {
+        env_prefix_ = prefix;
+    }
+
+    void ArgParser::SetLazyConversion(bool lazy) {
+        lazy_ = lazy;
+    }
+
+    void ArgParser::SetConfigFile(const std::string& path) {
+        auto file = std::make_unique<MappedFile>();
+        if (!file->Open(path)) {
+            throw settings_exception("Can't read config file [" + path + "]");
+        }
+        config_file_ = std::move(file);
+    }
+
+    void ArgParser::AddSubcommand(const std::string& name,
+                                  std::function<void(ArgParser&)> builder,
+                                  const std::string& description) {
+        if (FindSubcommand(name) != kNoSubcommand) {
+            throw settings_exception("Subcommand [" + name + "] is registered more than once");
+        }
+        subcommands_.push_back(SubcommandEntry{name, description, std::move(builder), nullptr});
+        help_text_.clear();
+    }
+
+    size_t ArgParser::FindSubcommand(std::string_view name) const {
+        for (size_t i = 0; i < subcommands_.size(); i++) {
+            if (subcommands_[i].name == name) {
+                return i;
+            }
+        }
+        return kNoSubcommand;
+    }
+
+    ArgParser& ArgParser::BuildSubcommand(size_t index) {
+        SubcommandEntry& subcommand = subcommands_[index];
+        if (subcommand.parser == nullptr) {
+            subcommand.parser = std::make_unique<ArgParser>(name_ + " " + subcommand.name);
+            subcommand.builder(*subcommand.parser);
+        }
+        return *subcommand.parser;
+    }
+
+    ArgParser& ArgParser::EnterSubcommand(size_t index) {
+        ArgParser& subcommand = BuildSubcommand(index);
+        selected_subcommand_ = index;
+        return subcommand;
+    }
+
+    ArgParser* ArgParser::Subcommand() {
+        return selected_subcommand_ == kNoSubcommand ? nullptr : subcommands_[selected_subcommand_].parser.get();
+    }
+
+    std::string_view ArgParser::SubcommandName() const {
+        return selected_subcommand_ == kNoSubcommand ? std::string_view() : subcommands_[selected_subcommand_].name;
     }
 
     bool ArgParser::Help() const {
         return found_help_;
     }
 
-    std::string ArgParser::HelpDescription() {
-        if (help_ == std::nullopt) {
-            return "";
-        }
-        std::stringstream result;
-        result << name_ << "\n";
-        for (const auto& key : keys_) {
-            if (!key.second->short_key.empty()) {
-                result << '-' << key.second->short_key;
+    void ArgParser::RenderHelp() {
+        auto left_column = [](const Key& key) {
+            std::string column = key.short_key.empty() ? "    " : "-" + std::string(key.short_key) + ", ";
+            if (!key.long_key.empty()) {
+                column += "--";
+                column += key.long_key;
+            } else if (!key.short_key.empty()) {
+                column.resize(column.size() - 2);
+            }
+            if (key.type == kIntArgument) {
+                column += "=<int>";
+            } else if (key.type == kStringArgument) {
+                column += "=<string>";
+            } else if (key.type == kValueArgument) {
+                column += "=<value>";
+            }
+            return column;
+        };
+        auto annotation = [](const Key& key) {
+            std::string result;
+            if (key.type == kIntArgument || key.type == kStringArgument || key.type == kValueArgument) {
+                const ArgumentBase& argument = key.type == kIntArgument ? *key.int_argument
+                                             : key.type == kStringArgument ? *key.string_argument
+                                                                           : *key.argument;
+                if (argument.positional_) {
+                    result += " [positional]";
+                }
+                if (!argument.multi_value_ && argument.min_number_of_values_ == 0) {
+                    result += " [optional]";
+                }
+                if (argument.multi_value_) {
+                    result += " [repeated, min args = " + std::to_string(argument.min_number_of_values_) + "]";
+                }
             }
-            if (!key.second->long_key.empty()) {
-                result << "\t--" << key.second->long_key;
+            if (key.type == kIntArgument && !key.int_argument->multi_value_ && key.int_argument->defaults_ != nullptr) {
+                result += " [default = " + std::to_string(key.int_argument->DefaultValue(0)) + "]";
+            } else if (key.type == kStringArgument && !key.string_argument->multi_value_
+                && key.string_argument->defaults_ != nullptr) {
+                result += " [default = " + key.string_argument->DefaultValue(0) + "]";
+            } else if (key.type == kFlagArgument && key.flag->default_value_) {
+                result += " [default = true]";
             }
-            if (!key.second->description.empty()) {
-                result << "\t" << key.second->description;
+            return result;
+        };
+
+        std::vector<std::string> columns;
+        columns.reserve(keys_.size() + 1);
+        size_t width = 0;
+        for (const Key& key : keys_) {
+            width = std::max(width, columns.emplace_back(left_column(key)).size());
+        }
+        width = std::max(width, columns.emplace_back(left_column(*help_)).size());
+        for (const SubcommandEntry& subcommand : subcommands_) {
+            width = std::max(width, subcommand.name.size());
+        }
+
+        help_text_.clear();
+        help_text_ += name_;
+        help_text_ += '\n';
+        if (!help_->description.empty()) {
+            help_text_ += help_->description;
+            help_text_ += '\n';
+        }
+        help_text_ += '\n';
+        auto append_line = [this, width](const std::string& column, std::string_view description) {
+            help_text_ += column;
+            help_text_.append(width - column.size() + 2, ' ');
+            help_text_ += description;
+            help_text_ += '\n';
+        };
+        size_t index = 0;
+        for (const Key& key : keys_) {
+            std::string description = std::string(key.description) + annotation(key);
+            append_line(columns[index++], key.description.empty() ? description.substr(description.empty() ? 0 : 1)
+                                                                  : description);
+        }
+        if (!subcommands_.empty()) {
+            help_text_ += "\nSubcommands:\n";
+            for (const SubcommandEntry& subcommand : subcommands_) {
+                append_line(subcommand.name, subcommand.description);
             }
-            result << '\n';
         }
-        return result.str();
+        help_text_ += '\n';
+        append_line(columns.back(), kHelpLine);
+    }
+
+    std::string_view ArgParser::HelpDescription() {
+        if (help_ == std::nullopt) {
+            return "";
+        }
+        if (!frozen_) {
+            Freeze();
+        }
+        if (help_text_.empty()) {
+            RenderHelp();
+        }
+        return help_text_;
+    }
+
+    bool ArgParser::WriteHelp(int fd) {
+        std::string_view text = HelpDescription();
+#ifdef _WIN32
+        return _write(fd, text.data(), static_cast<unsigned>(text.size())) == static_cast<int>(text.size());
+#else
+        return write(fd, text.data(), text.size()) == static_cast<ssize_t>(text.size());
+#endif
     }
-}
\ No newline at end of file
+}
@@ -1,12 +1,25 @@
 #pragma once
 
+#include <array>
 #include <string>
-#include <map>
+#include <string_view>
+#include <span>
 #include <utility>
+#include <variant>
 #include <vector>
 #include <optional>
 #include <sstream>
+#include <deque>
+#include <forward_list>
+#include <expected>
+#include <functional>
+#include <istream>
 #include <memory>
+#include <memory_resource>
+
+#include "KeyTable.h"
+#include "ParseStats.h"
+#include "ValueConverter.h"
 
 namespace ArgumentParser {
     class argument_parser_exception : public std::exception {
@@ -29,29 +42,139 @@ namespace ArgumentParser {
         explicit settings_exception(std::string message) : argument_parser_exception(std::move(message)) {}
     };
 
-    enum StoreType {
-        kIntArgument, kStringArgument, kFlagArgument
+    enum class ParseErrorCode {
+        kUnknownKey,
+        kAmbiguousKey,
+        kUnexpectedPositional,
+        kNotAnInteger,
+        kValueOutOfRange,
+        kInvalidValue,
+        kFlagWithValue,
+        kNotAFlag,
+        kMissingValue,
+        kRequirementsNotMet,
+    };
+
+    // What TryParse returns instead of throwing. token_index counts tokens
+    // after the program name from 1; it is 0 when the value came from a
+    // fallback source, which is then named in source.
+    struct ParseError {
+        ParseErrorCode code = ParseErrorCode::kUnknownKey;
+        size_t token_index = 0;
+        std::string key;
+        std::string value;
+        std::string source;
+        // Closest registered key for kUnknownKey, if one is near enough.
+        std::string suggestion;
+
+        // The text parse_exception carries for the same error.
+        [[nodiscard]] std::string Message() const;
     };
 
+    class ArgParser;
+
+    class ParseResult;
+
+    // Typed position of an option in its parser. Reading through a handle
+    // skips the key lookup entirely.
     template<typename T>
-    class Argument {
+    class ArgumentHandle {
+     private:
+        uint32_t index_ = 0;
+
+        explicit ArgumentHandle(uint32_t index) : index_(index) {}
+
+        template<typename>
+        friend class Argument;
+
+        friend class Flag;
+
+        friend class ArgParser;
+
+        friend class ParseResult;
      public:
-        std::vector<T> vector_data_;
-        std::vector<T>* values_;
-        T data_;
-        T* value_;
-        std::optional<T> default_value_ = std::nullopt;
-        std::optional<std::vector<T>> default_values_ = std::nullopt;
+        ArgumentHandle() = default;
+    };
 
+    using IntHandle = ArgumentHandle<int>;
+    using StringHandle = ArgumentHandle<std::string>;
+    using FlagHandle = ArgumentHandle<bool>;
+
+    // The type-independent part of every Argument<T>. Options added with
+    // AddArgument<T> are parsed through it, so a new value type needs a
+    // ValueConverter rather than another branch in the parser.
+    class ArgumentBase {
+     public:
         uint64_t min_number_of_values_ = 1;
         uint64_t number_of_values_ = 0;
+        uint32_t key_index_ = 0;
         bool positional_ = false;
         bool multi_value_ = false;
+        // Values go to a StoreTo callback and aren't kept.
+        bool streamed_ = false;
+        ArgParser* parser_ = nullptr;
+
+        virtual ~ArgumentBase() = default;
+
+        // Tells the parser that its help text is stale, and with layout that
+        // the positional order has to be frozen again.
+        void Changed(bool layout) const;
+
+        // Where defaults are allocated: the parser's arena once registered.
+        [[nodiscard]] std::pmr::memory_resource* Arena() const;
+
+        // Converts and stores token, false if it isn't a valid value.
+        [[nodiscard]] virtual bool Store(std::string_view token) = 0;
+
+        // Only checks that token converts.
+        [[nodiscard]] virtual bool Accepts(std::string_view token) const = 0;
+
+        [[nodiscard]] virtual bool IsCorrect(uint64_t number_of_values) const = 0;
+
+        virtual void Reset() = 0;
+    };
+
+    // Holds either one value or a vector of them, depending on MultiValue().
+    // Defaults live in the parser's arena and the StoreTo callback out of
+    // line, both only when set.
+    template<typename T>
+    class Argument : public ArgumentBase {
+     public:
+        using Sink = std::function<void(const T&)>;
+
+        std::variant<T, std::vector<T>> storage_;
+        // Points into storage_ unless StoreValue/StoreValues redirected it;
+        // sink_ is owned and used while streamed_.
+        union {
+            T* value_;
+            std::vector<T>* values_;
+            Sink* sink_;
+        };
+        // Allocated in the parser's arena by the first Default().
+        std::pmr::vector<T>* defaults_ = nullptr;
+
+        Argument() : value_(&std::get<T>(storage_)) {}
+
+        Argument(const Argument&) = delete;
+
+        Argument& operator=(const Argument&) = delete;
 
-        Argument() : value_(&data_), values_(&vector_data_) {}
+        ~Argument() override {
+            if (streamed_) {
+                delete sink_;
+            }
+            if (defaults_ != nullptr) {
+                std::destroy_at(defaults_);
+            }
+        }
+
+        [[nodiscard]] ArgumentHandle<T> Handle() const {
+            return ArgumentHandle<T>(key_index_);
+        }
 
         Argument<T>& Positional() {
             positional_ = true;
+            Changed(true);
             return *this;
         }
 
@@ -59,7 +182,7 @@ namespace ArgumentParser {
             if (multi_value_) {
                 throw settings_exception("You can't store single value in multi-value argument");
             }
-            default_value_ = default_value;
+            SetDefaults(std::span<const T>(&default_value, 1));
             return *this;
         }
 
@@ -67,13 +190,28 @@ namespace ArgumentParser {
             if (!multi_value_) {
                 throw settings_exception("You can't store multi-value value in single-value argument");
             }
-            default_values_ = default_value;
+            SetDefaults(default_value);
+            return *this;
+        }
+
+        // A single value that may be left out without a Default(); the
+        // parser's Has() tells whether it was given.
+        Argument<T>& Optional() {
+            if (multi_value_) {
+                throw settings_exception("Use MultiValue(0) for an optional multi-value argument");
+            }
+            min_number_of_values_ = 0;
+            Changed(false);
             return *this;
         }
 
         Argument<T>& MultiValue(uint64_t min_number_of_values = 0) {
             min_number_of_values_ = min_number_of_values;
-            multi_value_ = true;
+            if (!multi_value_) {
+                multi_value_ = true;
+                values_ = &storage_.template emplace<std::vector<T>>();
+            }
+            Changed(true);
             return *this;
         }
 
@@ -89,22 +227,152 @@ namespace ArgumentParser {
             if (!multi_value_) {
                 throw settings_exception("You can't store multi-value value in single-value argument");
             }
+            if (streamed_) {
+                delete sink_;
+                streamed_ = false;
+            }
             values_ = &values;
             return *this;
         }
 
-        void SetValue(const T& value) {
+        // Hands every value of a multi-value argument to sink as soon as it is
+        // converted instead of collecting them, MultiValue(min) still counts.
+        // Values() is empty for such an argument; ParseToResult isn't affected.
+        Argument<T>& StoreTo(Sink sink) {
+            if (!multi_value_) {
+                throw settings_exception("You can't stream values of single-value argument");
+            }
+            if (streamed_) {
+                *sink_ = std::move(sink);
+            } else {
+                sink_ = new Sink(std::move(sink));
+                streamed_ = true;
+            }
+            return *this;
+        }
+
+        void SetDefaults(std::span<const T> values) {
+            if (defaults_ == nullptr) {
+                std::pmr::polymorphic_allocator<> allocator(Arena());
+                defaults_ = allocator.new_object<std::pmr::vector<T>>(values.begin(), values.end());
+            } else {
+                defaults_->assign(values.begin(), values.end());
+            }
+            Changed(false);
+        }
+
+        void SetValue(T value) {
             number_of_values_++;
-            if (multi_value_) {
-                values_->push_back(value);
+            if (streamed_) {
+                (*sink_)(value);
+            } else if (multi_value_) {
+                values_->push_back(std::move(value));
+            } else {
+                *value_ = std::move(value);
+            }
+        }
+
+        void SetValues(std::span<const T> values) {
+            if (values.empty()) {
+                return;
+            }
+            number_of_values_ += values.size();
+            if (streamed_) {
+                for (const T& value : values) {
+                    (*sink_)(value);
+                }
+            } else if (multi_value_) {
+                values_->insert(values_->end(), values.begin(), values.end());
             } else {
-                *value_ = value;
+                *value_ = values.back();
+            }
+        }
+
+        [[nodiscard]] bool Store(std::string_view token) override {
+            T value;
+            if (!ValueConverter<T>::Parse(token, value)) {
+                return false;
+            }
+            SetValue(std::move(value));
+            return true;
+        }
+
+        [[nodiscard]] bool Accepts(std::string_view token) const override {
+            T value;
+            return ValueConverter<T>::Parse(token, value);
+        }
+
+        [[nodiscard]] bool IsCorrect(uint64_t number_of_values) const override {
+            return number_of_values >= min_number_of_values_ || (number_of_values == 0 && defaults_ != nullptr);
+        }
+
+        [[nodiscard]] bool IsCorrect() const {
+            return IsCorrect(number_of_values_);
+        }
+
+        // StoreValue, StoreValues or StoreTo send the values elsewhere.
+        [[nodiscard]] bool Redirected() const {
+            if (multi_value_) {
+                return streamed_ || values_ != std::get_if<std::vector<T>>(&storage_);
+            }
+            return value_ != std::get_if<T>(&storage_);
+        }
+
+        // Whether reads fall back to the defaults after number_of_values
+        // values: too few were given, or none and there are defaults.
+        [[nodiscard]] bool UsesDefaults(uint64_t number_of_values) const {
+            return number_of_values < min_number_of_values_ || (number_of_values == 0 && defaults_ != nullptr);
+        }
+
+        // The value an argument without defaults reads as when it wasn't
+        // given: T() for Optional(), an error if it was required.
+        [[nodiscard]] const T& DefaultValue(size_t index) const {
+            if (defaults_ == nullptr) {
+                if (min_number_of_values_ != 0) {
+                    throw parse_exception("Argument has no value and no default");
+                }
+                static const T unset{};
+                return unset;
+            }
+            return (*defaults_)[multi_value_ ? index : 0];
+        }
+
+        [[nodiscard]] std::span<const T> DefaultValues() const {
+            return defaults_ != nullptr ? std::span<const T>(*defaults_) : std::span<const T>();
+        }
+
+        // The parsed value, or the default one when too few were given.
+        [[nodiscard]] const T& Value(size_t index) const {
+            if (streamed_ && number_of_values_ != 0) {
+                throw settings_exception("Values of a StoreTo argument aren't kept");
+            }
+            if (UsesDefaults(number_of_values_)) {
+                return DefaultValue(index);
+            }
+            return multi_value_ ? (*values_)[index] : *value_;
+        }
+
+        // All parsed values, or the defaults when too few were given.
+        [[nodiscard]] std::span<const T> Values() const {
+            if (streamed_ && number_of_values_ != 0) {
+                return {};
             }
+            if (UsesDefaults(number_of_values_)) {
+                return DefaultValues();
+            }
+            return multi_value_ ? std::span<const T>(*values_) : std::span<const T>(value_, 1);
         }
 
-        bool IsCorrect() {
-            return number_of_values_ >= min_number_of_values_
-                || (number_of_values_ == 0 && (default_value_ != std::nullopt || default_values_ != std::nullopt));
+        void Reset() override {
+            number_of_values_ = 0;
+            if (streamed_) {
+                return;
+            }
+            if (multi_value_) {
+                values_->clear();
+            } else {
+                *value_ = defaults_ != nullptr ? defaults_->front() : T();
+            }
         }
     };
 
@@ -112,26 +380,52 @@ namespace ArgumentParser {
      public:
         bool data_;
         bool* value_;
+        bool default_value_;
+        uint32_t key_index_ = 0;
+        // How many times the parse set it, so a fallback can't override argv.
+        uint32_t times_set_ = 0;
+        ArgParser* parser_ = nullptr;
+
+        Flag() : data_(false), value_(&data_), default_value_(false) {}
+
+        [[nodiscard]] FlagHandle Handle() const {
+            return FlagHandle(key_index_);
+        }
 
-        Flag() : data_(false), value_(&data_) {}
+        // Same as ArgumentBase::Changed, a flag has no layout to change.
+        void Changed() const;
 
         Flag& Default(bool default_value) {
+            default_value_ = default_value;
             *value_ = default_value;
+            Changed();
             return *this;
         }
 
         Flag& StoreValue(bool& store_value) {
             value_ = &store_value;
+            *value_ = default_value_;
             return *this;
         }
+
+        void Reset() {
+            *value_ = default_value_;
+            times_set_ = 0;
+        }
     };
 
     struct Key {
-        std::string short_key;
-        std::string long_key;
-        std::string description;
+        std::pmr::string short_key;
+        std::pmr::string long_key;
+        std::pmr::string description;
 
         StoreType type;
+        union {
+            Argument<int>* int_argument = nullptr;
+            Argument<std::string>* string_argument;
+            ArgumentBase* argument;
+            Flag* flag;
+        };
 
         static std::string Concat(const Key& key) {
             std::stringstream result;
@@ -148,6 +442,103 @@ namespace ArgumentParser {
         }
     };
 
+    class StatsRecorder;
+
+    class MappedFile;
+
+    class ParseResult {
+     private:
+        // What the parse gave one key. Keys it didn't see have no entry, so
+        // a result costs nothing for the options left out.
+        struct Entry {
+            uint32_t key_index = 0;
+            uint64_t count = 0;
+            // Value of a flag, a fallback source may set it to false.
+            bool flag = false;
+            std::vector<int> int_values;
+            // Also the raw tokens of AddArgument<T> options.
+            std::vector<std::string> string_values;
+        };
+
+        // Up to this many entries are searched linearly, past it index_ maps
+        // every key index to its entry.
+        static constexpr size_t kIndexedEntries = 32;
+
+        const ArgParser* parser_;
+        std::vector<Entry> entries_;
+        // Position in entries_ plus one by key index, 0 for no entry.
+        std::vector<uint32_t> index_;
+        bool found_help_{false};
+        bool correct_{false};
+#ifdef ARGPARSER_INSTRUMENTATION
+        ParseStats stats_;
+#endif
+
+        explicit ParseResult(const ArgParser& parser);
+
+        [[nodiscard]] size_t Position(uint32_t key_index) const;
+
+        [[nodiscard]] const Entry* Find(uint32_t key_index) const;
+
+        // The entry of key_index, added if the key wasn't seen yet.
+        Entry& Add(uint32_t key_index);
+
+        [[nodiscard]] uint64_t Count(uint32_t key_index) const;
+
+        [[nodiscard]] const KeySlot& FindTypedKey(std::string_view key, StoreType type) const;
+
+        [[nodiscard]] bool CheckCorrectness() const;
+
+        template<typename T>
+        [[nodiscard]] const T& Value(const Argument<T>& argument, uint32_t key_index, size_t index) const;
+
+        template<typename T>
+        [[nodiscard]] std::span<const T> Values(const Argument<T>& argument, uint32_t key_index) const;
+
+        template<typename T>
+        [[nodiscard]] T Converted(const KeySlot& slot, size_t index) const;
+
+        friend class ArgParser;
+
+        friend class ResultTarget;
+     public:
+        [[nodiscard]] bool IsCorrect() const;
+
+        [[nodiscard]] bool Help() const;
+
+        [[nodiscard]] bool GetFlag(const std::string& flag) const;
+
+        [[nodiscard]] int GetIntValue(const std::string& key, int index = 0) const;
+
+        [[nodiscard]] std::string GetStringValue(const std::string& key, int index = 0) const;
+
+        [[nodiscard]] std::string_view GetStringView(const std::string& key, int index = 0) const;
+
+        [[nodiscard]] std::span<const int> GetIntValues(const std::string& key) const;
+
+        [[nodiscard]] std::span<const std::string> GetStringValues(const std::string& key) const;
+
+        [[nodiscard]] int Get(IntHandle handle, size_t index = 0) const;
+
+        [[nodiscard]] const std::string& Get(StringHandle handle, size_t index = 0) const;
+
+        [[nodiscard]] bool Get(FlagHandle handle) const;
+
+        // Same as ArgParser::Has for this result.
+        [[nodiscard]] bool Has(const std::string& key) const;
+
+        // Options added with AddArgument<T> are kept as tokens here and
+        // converted on every read; use the parser's own storage or handles
+        // in hot loops.
+        template<typename T>
+        [[nodiscard]] T GetValue(const std::string& key, int index = 0) const;
+
+        template<typename T>
+        [[nodiscard]] T Get(ArgumentHandle<T> handle, size_t index = 0) const;
+
+        [[nodiscard]] const ParseStats& Stats() const;
+    };
+
     class ArgParser {
      private:
 
@@ -156,31 +547,205 @@ namespace ArgumentParser {
         std::optional<Key> help_{std::nullopt};
         bool found_help_{false};
 
-        std::map<std::string, std::shared_ptr<Key>> keys_;
-        std::map<std::string, std::shared_ptr<Argument<int>>> int_arguments_;
-        std::map<std::string, std::shared_ptr<Argument<std::string>>> string_arguments_;
-        std::map<std::string, std::shared_ptr<Flag>> flags_;
+        std::pmr::monotonic_buffer_resource arena_;
+        std::pmr::deque<Key> keys_{&arena_};
+        std::pmr::deque<Argument<int>> int_arguments_{&arena_};
+        std::pmr::deque<Argument<std::string>> string_arguments_{&arena_};
+        std::pmr::deque<Flag> flags_{&arena_};
+        // Arguments of other types, created in arena_ by AddArgument<T>.
+        std::pmr::deque<ArgumentBase*> value_arguments_{&arena_};
+
+        struct PositionalSlot {
+            KeySlot slot;
+            bool multi_value = false;
+        };
+
+        KeyTable table_;
+        // Single-character names indexed by the character, they are looked
+        // up once per letter of a -abc cluster.
+        std::array<const KeySlot*, 256> short_keys_{};
+        // Resolves --abbreviations and suggests keys for misses.
+        PrefixIndex prefixes_;
+        std::vector<PositionalSlot> positionals_;
+        bool frozen_{false};
+
+        // Rendered on the first HelpDescription() after Freeze(), dropped
+        // by the next Freeze() or a builder call that changes the text.
+        std::string help_text_;
+
+        struct Stream;
+        std::unique_ptr<Stream> stream_;
+
+        struct SubcommandEntry {
+            std::string name;
+            std::string description;
+            std::function<void(ArgParser&)> builder;
+            std::unique_ptr<ArgParser> parser;
+        };
+
+        static constexpr size_t kNoSubcommand = static_cast<size_t>(-1);
+
+        std::vector<SubcommandEntry> subcommands_;
+        size_t selected_subcommand_{kNoSubcommand};
+
+        std::string env_prefix_;
+        std::unique_ptr<MappedFile> config_file_;
+
+        // Unconverted tokens of int and string arguments by key index, filled
+        // in lazy mode and converted by the first read of the argument.
+        bool lazy_{false};
+        mutable std::vector<std::vector<std::string_view>> raw_values_;
+        // Copies of tokens the caller doesn't keep alive (Feed, a vector of
+        // strings); raw_values_ points into it until Reset(). A list, so an
+        // eager parser never allocates it.
+        std::forward_list<std::string> copied_tokens_;
+
+#ifdef ARGPARSER_INSTRUMENTATION
+        ParseStats stats_;
+        StatsCallback stats_callback_;
+#endif
+
+        StatsRecorder RecordStats();
+
+        StatsRecorder RecordStats(ParseResult& result) const;
+
+        void RenderHelp();
+
+        void SchemaChanged(bool layout);
+
+        [[nodiscard]] size_t FindSubcommand(std::string_view name) const;
+
+        ArgParser& BuildSubcommand(size_t index);
+
+        ArgParser& EnterSubcommand(size_t index);
+
+        void WriteBashCompletion(std::string& script, const std::string& function);
+
+        void WriteZshCompletion(std::string& script, const std::string& function);
 
         [[nodiscard]] bool CheckCorrectness() const;
 
-        void UpdatePositionalArgument(const std::string& value);
+        [[nodiscard]] const KeySlot& FindKey(std::string_view key) const;
+
+        [[nodiscard]] const KeySlot& FindTypedKey(std::string_view key, StoreType type);
+
+        void ConvertRaw(uint32_t key_index) const;
+
+        Key& RegisterKey(const std::string& short_key,
+                         const std::string& long_key,
+                         const std::string& description,
+                         StoreType type);
+
+        template<typename T>
+        Argument<T>& RegisterArgument(std::pmr::deque<Argument<T>>& arguments,
+                                      StoreType type,
+                                      const std::string& short_key,
+                                      const std::string& long_key,
+                                      const std::string& description);
+
+        template<typename T>
+        Argument<T>& RegisterValueArgument(const std::string& short_key,
+                                           const std::string& long_key,
+                                           const std::string& description);
+
+        template<typename T>
+        const Argument<T>& TypedArgument(const std::string& key);
+
+        Flag& RegisterFlag(const std::string& short_flag,
+                           const std::string& long_flag,
+                           const std::string& description);
+
+        // Parse errors either throw parse_exception or come back as the
+        // unexpected value, the bool is the CheckCorrectness() result.
+        template<typename Iterator>
+        std::expected<bool, ParseError> RunTokens(Iterator begin, Iterator end, bool throw_errors);
 
-        void UpdateShortFlags(const std::string& raw_key);
+        template<typename Iterator>
+        bool ParseTokens(Iterator begin, Iterator end);
 
-        void UpdateFlag(const std::string& raw_key);
+        template<typename Iterator>
+        std::expected<void, ParseError> TryParseTokens(Iterator begin, Iterator end);
 
-        void SetArgument(const std::string& argument_name, const std::string& value);
+        std::expected<void, ParseError> FeedStream(std::string_view token, bool throw_errors);
 
-        void UpdateArgument(const std::string& equation);
+        std::expected<bool, ParseError> FinishStream(bool throw_errors);
 
-        void UpdateArgument(const std::string& raw_argument_name, const std::string& value);
+        [[nodiscard]] std::string FirstIncorrectKey() const;
+
+        template<typename Iterator>
+        ParseResult ParseTokensToResult(Iterator begin, Iterator end) const;
+
+        template<typename Target>
+        friend class ParseRun;
+
+        friend class SchemaTarget;
+
+        friend class ParseResult;
+
+        friend class ArgumentBase;
+
+        friend class Flag;
      public:
-        explicit ArgParser(std::string name) : name_(std::move(name)) {};
+        explicit ArgParser(std::string name);
+
+        // Reserves the schema arena up front so that registering about
+        // expected_options options, defaults included, costs a single
+        // allocation.
+        ArgParser(std::string name, size_t expected_options);
+
+        ~ArgParser();
+
+        ArgParser(const ArgParser&) = delete;
+
+        ArgParser& operator=(const ArgParser&) = delete;
+
+        void Freeze();
 
         bool Parse(const std::vector<std::string>& data);
 
+        bool Parse(std::span<const std::string_view> data);
+
         bool Parse(int argc, char** argv);
 
+        // Same as Parse, but reports a malformed command line or missing
+        // values as a ParseError instead of throwing or returning false.
+        std::expected<void, ParseError> TryParse(const std::vector<std::string>& data);
+
+        std::expected<void, ParseError> TryParse(std::span<const std::string_view> data);
+
+        std::expected<void, ParseError> TryParse(int argc, char** argv);
+
+        // Reads whitespace-separated tokens until the end of input. Unlike
+        // argv there's no program name to skip.
+        bool Parse(std::istream& input);
+
+        // Incremental form of Parse: tokens are fed one at a time (again
+        // without a program name) and Finish() validates the result.
+        void Feed(std::string_view token);
+
+        bool Finish();
+
+        // Parses without touching the registered arguments: the values go to
+        // the returned ParseResult, so one frozen parser can serve many threads.
+        [[nodiscard]] ParseResult ParseToResult(const std::vector<std::string>& data) const;
+
+        [[nodiscard]] ParseResult ParseToResult(std::span<const std::string_view> data) const;
+
+        [[nodiscard]] ParseResult ParseToResult(int argc, char** argv) const;
+
+        // Clears the results of previous Parse calls: flags and single values
+        // go back to their defaults, multi-value storages are emptied but keep
+        // their capacity.
+        void Reset();
+
+        // Counters of the last Parse or Feed/Finish run; all zero unless the
+        // library is built with ARGPARSER_INSTRUMENTATION.
+        [[nodiscard]] const ParseStats& Stats() const;
+
+        // Called after every parse, failed ones included. ParseToResult calls
+        // it too, possibly from several threads at once.
+        void SetStatsCallback(StatsCallback callback);
+
         Flag& AddFlag(char short_flag, const std::string& long_flag);
 
         Flag& AddFlag(const std::string& long_flag, const std::string& description);
@@ -205,15 +770,195 @@ namespace ArgumentParser {
                                                  const std::string& long_key,
                                                  const std::string& description);
 
+        // Any type with a ValueConverter: arithmetic types go through
+        // from_chars, enums through EnumNames. int and std::string are the
+        // same options as AddIntArgument/AddStringArgument.
+        template<typename T>
+        Argument<T>& AddArgument(const std::string& long_key, const std::string& description = "");
+
+        template<typename T>
+        Argument<T>& AddArgument(char short_key, const std::string& long_key, const std::string& description = "");
+
+        template<typename T>
+        const T& GetValue(const std::string& key, int index = 0);
+
+        template<typename T>
+        std::span<const T> GetValues(const std::string& key);
+
+        template<typename T>
+        [[nodiscard]] const T& Get(ArgumentHandle<T> handle, size_t index = 0) const;
+
         int GetIntValue(const std::string& key, int index = 0);
 
         std::string GetStringValue(const std::string& key, int index = 0);
 
+        // Copy-free reads. The bulk getters return the defaults when nothing
+        // was supplied; the views stay valid until the next parse or Reset().
+        std::string_view GetStringView(const std::string& key, int index = 0);
+
+        std::span<const int> GetIntValues(const std::string& key);
+
+        std::span<const std::string> GetStringValues(const std::string& key);
+
+        // Constant-time reads for handles returned by Argument::Handle() and
+        // Flag::Handle() of this parser.
+        [[nodiscard]] int Get(IntHandle handle, size_t index = 0) const;
+
+        [[nodiscard]] const std::string& Get(StringHandle handle, size_t index = 0) const;
+
+        [[nodiscard]] bool Get(FlagHandle handle) const;
+
+        // Whether the last parse gave key a value or set the flag, fallback
+        // sources included.
+        bool Has(const std::string& key);
+
+        // Lower-priority sources for options that argv leaves out. Priority is
+        // argv > environment > config file > Default(). The variable of an
+        // option is the prefix plus its upper-cased long key with '-' as '_'
+        // (APP_ + max-keys -> APP_MAX_KEYS); a multi-value option splits it
+        // on whitespace and a flag takes 1/true/yes/on or 0/false/no/off.
+        // The config file is mmap'ed and holds one "key = value" per line,
+        // repeated lines add values.
+        void SetEnvPrefix(const std::string& prefix);
+
+        void SetConfigFile(const std::string& path);
+
+        // Lazy mode: Parse only records the tokens of int and string
+        // arguments and checks their counts, each argument is converted on
+        // its first read and a bad value throws parse_exception from that
+        // read. Parse(argc, argv) and Parse(span) don't copy tokens, so they
+        // must outlive the reads (argv does); the std::vector<std::string>
+        // overloads, Feed and Parse(istream) keep their own copies until
+        // Reset(). Arguments with StoreValue, StoreValues or StoreTo are
+        // still converted while parsing.
+        void SetLazyConversion(bool lazy);
+
+        // Registers a subcommand whose options are added by builder. The
+        // builder runs only when name shows up as a positional token, every
+        // token after it then belongs to the subcommand's own parser.
+        void AddSubcommand(const std::string& name,
+                           std::function<void(ArgParser&)> builder,
+                           const std::string& description = "");
+
+        // The subcommand chosen by the last parse and its name, nullptr and
+        // an empty name if there was none.
+        [[nodiscard]] ArgParser* Subcommand();
+
+        [[nodiscard]] std::string_view SubcommandName() const;
+
         void AddHelp(char short_key, const std::string& long_key, const std::string& description);
 
         [[nodiscard]] bool Help() const;
 
-        std::string HelpDescription();
+        // Description of the help key itself, in the help and the completions.
+        static constexpr std::string_view kHelpLine = "Display this help and exit";
+
+        // One aligned line per option. Empty if AddHelp wasn't called.
+        std::string_view HelpDescription();
+
+        // Writes HelpDescription() to fd with a single write(2).
+        bool WriteHelp(int fd);
+
+        // Self-contained "bash" or "zsh" completion script for the schema,
+        // subcommands included (their builders run), so completing never
+        // starts the program. command is the name the script completes,
+        // the parser's name by default; either has to be a plain command
+        // word (letters, digits and _-.+/), otherwise settings_exception.
+        std::string GenerateCompletion(std::string_view shell, const std::string& command = "");
     };
 
+    template<typename T>
+    Argument<T>& ArgParser::RegisterValueArgument(const std::string& short_key,
+                                                  const std::string& long_key,
+                                                  const std::string& description) {
+        if constexpr (std::is_same_v<T, int>) {
+            return RegisterArgument(int_arguments_, kIntArgument, short_key, long_key, description);
+        } else if constexpr (std::is_same_v<T, std::string>) {
+            return RegisterArgument(string_arguments_, kStringArgument, short_key, long_key, description);
+        } else {
+            std::pmr::polymorphic_allocator<> allocator(&arena_);
+            Argument<T>* argument = allocator.new_object<Argument<T>>();
+            value_arguments_.push_back(argument);
+            argument->key_index_ = keys_.size();
+            argument->parser_ = this;
+            RegisterKey(short_key, long_key, description, kValueArgument).argument = argument;
+            return *argument;
+        }
+    }
+
+    template<typename T>
+    const Argument<T>& ArgParser::TypedArgument(const std::string& key) {
+        if constexpr (std::is_same_v<T, int>) {
+            return *FindTypedKey(key, kIntArgument).int_argument;
+        } else if constexpr (std::is_same_v<T, std::string>) {
+            return *FindTypedKey(key, kStringArgument).string_argument;
+        } else {
+            const auto* argument = dynamic_cast<const Argument<T>*>(FindTypedKey(key, kValueArgument).argument);
+            if (argument == nullptr) {
+                throw parse_exception("Key [" + key + "] has another type");
+            }
+            return *argument;
+        }
+    }
+
+    template<typename T>
+    Argument<T>& ArgParser::AddArgument(const std::string& long_key, const std::string& description) {
+        return RegisterValueArgument<T>("", long_key, description);
+    }
+
+    template<typename T>
+    Argument<T>& ArgParser::AddArgument(char short_key, const std::string& long_key, const std::string& description) {
+        return RegisterValueArgument<T>({short_key}, long_key, description);
+    }
+
+    template<typename T>
+    const T& ArgParser::GetValue(const std::string& key, int index) {
+        return TypedArgument<T>(key).Value(index);
+    }
+
+    template<typename T>
+    std::span<const T> ArgParser::GetValues(const std::string& key) {
+        return TypedArgument<T>(key).Values();
+    }
+
+    template<typename T>
+    const T& ArgParser::Get(ArgumentHandle<T> handle, size_t index) const {
+        return static_cast<const Argument<T>*>(keys_[handle.index_].argument)->Value(index);
+    }
+
+    template<typename T>
+    T ParseResult::Converted(const KeySlot& slot, size_t index) const {
+        const auto& argument = static_cast<const Argument<T>&>(*slot.argument);
+        const Entry* entry = Find(slot.index);
+        if (entry != nullptr && !argument.UsesDefaults(entry->count)) {
+            T value;
+            ValueConverter<T>::Parse(entry->string_values[argument.multi_value_ ? index : 0], value);
+            return value;
+        }
+        return argument.DefaultValue(index);
+    }
+
+    template<typename T>
+    T ParseResult::GetValue(const std::string& key, int index) const {
+        if constexpr (std::is_same_v<T, int>) {
+            return GetIntValue(key, index);
+        } else if constexpr (std::is_same_v<T, std::string>) {
+            return GetStringValue(key, index);
+        } else {
+            const KeySlot& slot = FindTypedKey(key, kValueArgument);
+            if (dynamic_cast<const Argument<T>*>(slot.argument) == nullptr) {
+                throw parse_exception("Key [" + key + "] has another type");
+            }
+            return Converted<T>(slot, index);
+        }
+    }
+
+    template<typename T>
+    T ParseResult::Get(ArgumentHandle<T> handle, size_t index) const {
+        KeySlot slot;
+        slot.index = handle.index_;
+        slot.argument = parser_->keys_[handle.index_].argument;
+        return Converted<T>(slot, index);
+    }
+
 } // namespace ArgumentParser
\ No newline at end of file
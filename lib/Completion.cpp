@@ -0,0 +1,239 @@
+#include "ArgParser.h"
+
+#include <algorithm>
+#include <cctype>
+
+namespace ArgumentParser {
+
+    namespace {
+        std::string FunctionName(std::string_view name) {
+            std::string function = "_";
+            for (char symbol : name) {
+                function += std::isalnum(static_cast<unsigned char>(symbol)) ? symbol : '_';
+            }
+            return function;
+        }
+
+        // Text inside a single-quoted zsh _arguments spec.
+        std::string ZshEscape(std::string_view text) {
+            std::string escaped;
+            for (char symbol : text) {
+                if (symbol == '\'') {
+                    escaped += "'\\''";
+                } else if (symbol == '\n') {
+                    escaped += ' ';
+                } else {
+                    if (symbol == '[' || symbol == ']' || symbol == ':' || symbol == '"' || symbol == '\\') {
+                        escaped += '\\';
+                    }
+                    escaped += symbol;
+                }
+            }
+            return escaped;
+        }
+
+        // The script registers completion for this word, so it has to be
+        // one shell word that needs no quoting.
+        bool IsCommandName(std::string_view name) {
+            return !name.empty() && std::all_of(name.begin(), name.end(), [](char symbol) {
+                return std::isalnum(static_cast<unsigned char>(symbol)) || symbol == '_' || symbol == '-'
+                    || symbol == '.' || symbol == '+' || symbol == '/';
+            });
+        }
+
+        std::string OneLine(std::string_view text) {
+            std::string line(text);
+            std::replace(line.begin(), line.end(), '\n', ' ');
+            return line;
+        }
+
+        const ArgumentBase* Base(const Key& key) {
+            switch (key.type) {
+                case kIntArgument:return key.int_argument;
+                case kStringArgument:return key.string_argument;
+                case kValueArgument:return key.argument;
+                default:return nullptr;
+            }
+        }
+
+        std::string_view TypeName(StoreType type) {
+            return type == kIntArgument ? "int" : type == kStringArgument ? "string" : "value";
+        }
+
+        std::string_view Description(const Key& key) {
+            return key.type == kHelpArgument ? ArgParser::kHelpLine : std::string_view(key.description);
+        }
+
+        std::string BashPattern(const Key& key) {
+            std::string pattern;
+            if (!key.short_key.empty()) {
+                pattern += "-" + std::string(key.short_key);
+            }
+            if (!key.long_key.empty()) {
+                pattern += (pattern.empty() ? "--" : "|--") + std::string(key.long_key);
+            }
+            return pattern;
+        }
+    }
+
+    // One function per parser. It hands the words after a subcommand name
+    // to that subcommand's function, completes the value of the option
+    // before the cursor, or else offers the options and subcommands.
+    void ArgParser::WriteBashCompletion(std::string& script, const std::string& function) {
+        std::vector<const Key*> keys;
+        for (const Key& key : keys_) {
+            keys.push_back(&key);
+        }
+        if (help_ != std::nullopt) {
+            keys.push_back(&*help_);
+        }
+
+        for (const Key* key : keys) {
+            script += "#   " + BashPattern(*key);
+            if (key->type != kFlagArgument && key->type != kHelpArgument) {
+                script += " <" + std::string(TypeName(key->type)) + ">";
+                if (Base(*key)->positional_) {
+                    script += " [positional]";
+                }
+            }
+            if (!Description(*key).empty()) {
+                script += "  " + OneLine(Description(*key));
+            }
+            script += '\n';
+        }
+        script += function + "() {\n";
+        script += "    local cur=\"${COMP_WORDS[COMP_CWORD]}\" prev=\"${COMP_WORDS[COMP_CWORD-1]}\" i\n";
+        script += "    [[ \"$cur\" == \"=\" ]] && cur=\"\"\n";
+        script += "    [[ \"$prev\" == \"=\" ]] && prev=\"${COMP_WORDS[COMP_CWORD-2]}\"\n";
+        std::string words;
+        if (!subcommands_.empty()) {
+            script += "    for ((i = $1; i < COMP_CWORD; i++)); do\n";
+            script += "        case \"${COMP_WORDS[i]}\" in\n";
+            for (size_t i = 0; i < subcommands_.size(); i++) {
+                script += "            " + subcommands_[i].name + ") " + function + "_" + FunctionName(subcommands_[i].name).substr(1)
+                    + " $((i + 1)); return ;;\n";
+                words += " " + subcommands_[i].name;
+            }
+            script += "        esac\n";
+            script += "    done\n";
+        }
+        std::string values;
+        for (const Key* key : keys) {
+            std::string pattern = BashPattern(*key);
+            words += " " + (key->long_key.empty() ? "-" + std::string(key->short_key) : "--" + std::string(key->long_key));
+            if (key->type == kStringArgument) {
+                values += "        " + pattern + ") compopt -o filenames; COMPREPLY=($(compgen -f -- \"$cur\")); return ;;\n";
+            } else if (key->type == kIntArgument || key->type == kValueArgument) {
+                values += "        " + pattern + ") return ;;\n";
+            }
+        }
+        if (!values.empty()) {
+            script += "    case \"$prev\" in\n" + values + "    esac\n";
+        }
+        script += "    COMPREPLY=($(compgen -W \"" + words.substr(words.empty() ? 0 : 1) + "\" -- \"$cur\"))\n";
+        script += "}\n\n";
+
+        for (size_t i = 0; i < subcommands_.size(); i++) {
+            script += "# " + subcommands_[i].name + ": " + OneLine(subcommands_[i].description) + "\n";
+            BuildSubcommand(i).WriteBashCompletion(script, function + "_" + FunctionName(subcommands_[i].name).substr(1));
+        }
+    }
+
+    // One _arguments call per parser; a subcommand's function gets the words
+    // from its name on through the *:: state.
+    void ArgParser::WriteZshCompletion(std::string& script, const std::string& function) {
+        std::vector<const Key*> keys;
+        for (const Key& key : keys_) {
+            keys.push_back(&key);
+        }
+        if (help_ != std::nullopt) {
+            keys.push_back(&*help_);
+        }
+
+        script += function + "() {\n";
+        script += "    local context state state_descr line\n";
+        script += "    typeset -A opt_args\n";
+        script += "    _arguments -s -C";
+        std::vector<std::string> positionals;
+        for (const Key* key : keys) {
+            const ArgumentBase* argument = Base(*key);
+            std::string action;
+            if (argument != nullptr) {
+                action = ":" + std::string(TypeName(key->type)) + ":" + (key->type == kStringArgument ? "_files" : " ");
+                if (argument->positional_) {
+                    positionals.push_back((argument->multi_value_ ? "'*:" : "':")
+                                              + ZshEscape(key->long_key.empty() ? key->short_key : key->long_key)
+                                              + action.substr(action.find(':', 1)) + "'");
+                }
+            }
+            bool repeated = argument != nullptr && argument->multi_value_;
+            std::string value_suffix = argument != nullptr ? "=" : "";
+            std::string description = "'[" + ZshEscape(Description(*key)) + "]" + action + "'";
+            script += " \\\n        ";
+            if (!key->short_key.empty() && !key->long_key.empty()) {
+                script += repeated ? "'*'" : "'(-" + std::string(key->short_key) + " --" + std::string(key->long_key) + ")'";
+                script += "{-" + std::string(key->short_key) + ",--" + std::string(key->long_key) + value_suffix + "}";
+            } else {
+                script += repeated ? "'*'" : "";
+                script += key->short_key.empty() ? "--" + std::string(key->long_key) + value_suffix
+                                                 : "-" + std::string(key->short_key);
+            }
+            script += description;
+        }
+        if (subcommands_.empty()) {
+            for (const std::string& positional : positionals) {
+                script += " \\\n        " + positional;
+            }
+            script += "\n";
+        } else {
+            script += " \\\n        '1:command:((";
+            for (size_t i = 0; i < subcommands_.size(); i++) {
+                script += (i == 0 ? "" : " ") + ZshEscape(subcommands_[i].name) + "\\:\""
+                    + ZshEscape(subcommands_[i].description) + "\"";
+            }
+            script += "))' \\\n        '*:: :->args'\n";
+            script += "    case $state in\n";
+            script += "        args)\n";
+            script += "            case $line[1] in\n";
+            for (const SubcommandEntry& subcommand : subcommands_) {
+                script += "                " + subcommand.name + ") " + function + "_" + FunctionName(subcommand.name).substr(1)
+                    + " ;;\n";
+            }
+            script += "            esac ;;\n";
+            script += "    esac\n";
+        }
+        script += "}\n\n";
+
+        for (size_t i = 0; i < subcommands_.size(); i++) {
+            BuildSubcommand(i).WriteZshCompletion(script, function + "_" + FunctionName(subcommands_[i].name).substr(1));
+        }
+    }
+
+    std::string ArgParser::GenerateCompletion(std::string_view shell, const std::string& command) {
+        const std::string& program = command.empty() ? name_ : command;
+        if (!IsCommandName(program)) {
+            throw settings_exception("Completion needs a command name, [" + program + "] isn't one");
+        }
+        std::string function = FunctionName(program);
+        std::string script;
+        if (shell == "bash") {
+            script += "# bash completion for " + program + ", generated from its ArgParser schema.\n";
+            script += "# Options:\n";
+            WriteBashCompletion(script, function);
+            script += function + "_complete() {\n";
+            script += "    COMPREPLY=()\n";
+            script += "    " + function + " 1\n";
+            script += "}\n\n";
+            script += "complete -F " + function + "_complete " + program + "\n";
+        } else if (shell == "zsh") {
+            script += "#compdef " + program + "\n";
+            script += "# zsh completion for " + program + ", generated from its ArgParser schema.\n\n";
+            WriteZshCompletion(script, function);
+            script += function + " \"$@\"\n";
+        } else {
+            throw settings_exception("There's no completion for shell [" + std::string(shell) + "]");
+        }
+        return script;
+    }
+
+} // namespace ArgumentParser
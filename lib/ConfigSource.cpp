@@ -0,0 +1,72 @@
+#include "ConfigSource.h"
+
+#include <cctype>
+
+#ifdef _WIN32
+#include <fstream>
+#include <sstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ArgumentParser {
+
+#ifdef _WIN32
+    MappedFile::~MappedFile() = default;
+
+    bool MappedFile::Open(const std::string& path) {
+        std::ifstream input(path, std::ios::binary);
+        if (!input) {
+            return false;
+        }
+        std::ostringstream content;
+        content << input.rdbuf();
+        buffer_ = content.str();
+        data_ = buffer_.data();
+        size_ = buffer_.size();
+        return true;
+    }
+#else
+    MappedFile::~MappedFile() {
+        if (size_ != 0) {
+            munmap(const_cast<char*>(data_), size_);
+        }
+    }
+
+    bool MappedFile::Open(const std::string& path) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat info{};
+        if (fstat(fd, &info) != 0) {
+            close(fd);
+            return false;
+        }
+        if (info.st_size == 0) {
+            close(fd);
+            return true;
+        }
+        void* data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (data == MAP_FAILED) {
+            return false;
+        }
+        data_ = static_cast<const char*>(data);
+        size_ = info.st_size;
+        return true;
+    }
+#endif
+
+    std::string EnvironmentName(std::string_view prefix, std::string_view key) {
+        std::string name(prefix);
+        for (char symbol : key) {
+            name += symbol == '-' ? '_' : static_cast<char>(std::toupper(static_cast<unsigned char>(symbol)));
+        }
+        return name;
+    }
+
+} // namespace ArgumentParser
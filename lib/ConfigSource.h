@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace ArgumentParser {
+    // Read-only view of a whole file, mapped with mmap where available.
+    class MappedFile {
+     private:
+        const char* data_ = nullptr;
+        size_t size_ = 0;
+#ifdef _WIN32
+        std::string buffer_;
+#endif
+     public:
+        MappedFile() = default;
+
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        bool Open(const std::string& path);
+
+        [[nodiscard]] std::string_view View() const {
+            return {data_, size_};
+        }
+    };
+
+    // Calls visit(key, value) for every line of a config text. A line is
+    // "key = value", "key value" or a bare "key"; blank lines and lines
+    // starting with # are skipped. Nothing beyond the line split is done, so
+    // values of keys the caller ignores are never converted.
+    template<typename Visitor>
+    void ForEachConfigEntry(std::string_view text, Visitor&& visit) {
+        constexpr std::string_view kSpaces = " \t\r";
+        auto trim = [kSpaces](std::string_view value) {
+            size_t begin = value.find_first_not_of(kSpaces);
+            if (begin == std::string_view::npos) {
+                return std::string_view();
+            }
+            return value.substr(begin, value.find_last_not_of(kSpaces) - begin + 1);
+        };
+        while (!text.empty()) {
+            size_t line_end = text.find('\n');
+            std::string_view line = trim(text.substr(0, line_end));
+            text.remove_prefix(line_end == std::string_view::npos ? text.size() : line_end + 1);
+            if (line.empty() || line[0] == '#') {
+                continue;
+            }
+            size_t key_end = line.find_first_of(" \t=");
+            std::string_view key = line.substr(0, key_end);
+            std::string_view value = key_end == std::string_view::npos ? std::string_view() : trim(line.substr(key_end));
+            if (value.starts_with('=')) {
+                value = trim(value.substr(1));
+            }
+            if (value.size() >= 2 && value.front() == '"' && value.back() == '"') {
+                value = value.substr(1, value.size() - 2);
+            }
+            visit(key, value);
+        }
+    }
+
+    // APP_ + "max-keys" -> APP_MAX_KEYS
+    std::string EnvironmentName(std::string_view prefix, std::string_view key);
+
+} // namespace ArgumentParser
@@ -0,0 +1,193 @@
+#include "IntegerParsing.h"
+
+#include <bit>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define ARGPARSER_SSSE3_KERNEL 1
+#endif
+
+namespace ArgumentParser {
+
+    namespace {
+        constexpr size_t kMaxShortDigits = 8;
+
+        struct Digits {
+            std::string_view digits;
+            bool negative = false;
+        };
+
+        bool SplitSign(std::string_view token, Digits& result) {
+            result.negative = !token.empty() && token[0] == '-';
+            if (!token.empty() && (token[0] == '-' || token[0] == '+')) {
+                token.remove_prefix(1);
+            }
+            result.digits = token;
+            return !token.empty();
+        }
+
+        uint64_t LoadDigits(std::string_view digits) {
+            char buffer[kMaxShortDigits];
+            std::memset(buffer, '0', kMaxShortDigits);
+            std::memcpy(buffer + kMaxShortDigits - digits.size(), digits.data(), digits.size());
+            uint64_t chunk;
+            std::memcpy(&chunk, buffer, kMaxShortDigits);
+            return chunk;
+        }
+
+        bool IsDigits(uint64_t chunk) {
+            return ((chunk & 0xF0F0F0F0F0F0F0F0ull)
+                | (((chunk + 0x0606060606060606ull) & 0xF0F0F0F0F0F0F0F0ull) >> 4)) == 0x3333333333333333ull;
+        }
+
+        uint32_t ConvertDigits(uint64_t chunk) {
+            chunk -= 0x3030303030303030ull;
+            chunk = (chunk * 10 + (chunk >> 8)) & 0x00FF00FF00FF00FFull;
+            chunk = (chunk * 100 + (chunk >> 16)) & 0x0000FFFF0000FFFFull;
+            return static_cast<uint32_t>(chunk * 10000 + (chunk >> 32));
+        }
+
+        // Up to 16 digits in two SWAR words; anything else goes to from_chars.
+        bool TryParseSwar(const Digits& token, int& value) {
+            if constexpr (std::endian::native != std::endian::little) {
+                return false;
+            }
+            std::string_view digits = token.digits;
+            if (digits.size() > 2 * kMaxShortDigits) {
+                return false;
+            }
+            uint64_t result = 0;
+            if (digits.size() > kMaxShortDigits) {
+                uint64_t high = LoadDigits(digits.substr(0, digits.size() - kMaxShortDigits));
+                if (!IsDigits(high)) {
+                    return false;
+                }
+                result = ConvertDigits(high) * 100000000ull;
+                digits.remove_prefix(digits.size() - kMaxShortDigits);
+            }
+            uint64_t low = LoadDigits(digits);
+            if (!IsDigits(low)) {
+                return false;
+            }
+            result += ConvertDigits(low);
+
+            uint64_t limit = static_cast<uint64_t>(std::numeric_limits<int>::max()) + token.negative;
+            if (result > limit) {
+                return false;
+            }
+            value = token.negative ? static_cast<int>(-static_cast<int64_t>(result)) : static_cast<int>(result);
+            return true;
+        }
+
+        IntegerStatus ParseIntegerSlow(std::string_view token, int& value) {
+            Digits split;
+            if (!SplitSign(token, split) || split.digits[0] == '-' || split.digits[0] == '+') {
+                return IntegerStatus::kInvalid;
+            }
+            if (token[0] == '+') {
+                token.remove_prefix(1);
+            }
+            auto [end, error] = std::from_chars(token.data(), token.data() + token.size(), value);
+            if (error == std::errc::result_out_of_range) {
+                return IntegerStatus::kOutOfRange;
+            }
+            if (error != std::errc() || end != token.data() + token.size()) {
+                return IntegerStatus::kInvalid;
+            }
+            return IntegerStatus::kOk;
+        }
+
+#ifdef ARGPARSER_SSSE3_KERNEL
+        bool HasSsse3() {
+            static const bool has_ssse3 = __builtin_cpu_supports("ssse3");
+            return has_ssse3;
+        }
+
+        // Two short tokens per register: bytes 0-7 hold the first one and
+        // bytes 8-15 the second, both right-aligned and padded with '0'.
+        __attribute__((target("ssse3")))
+        bool ConvertPair(std::string_view first, std::string_view second, uint32_t& first_value, uint32_t& second_value) {
+            alignas(16) char buffer[2 * kMaxShortDigits];
+            std::memset(buffer, '0', sizeof(buffer));
+            std::memcpy(buffer + kMaxShortDigits - first.size(), first.data(), first.size());
+            std::memcpy(buffer + 2 * kMaxShortDigits - second.size(), second.data(), second.size());
+
+            __m128i chars = _mm_load_si128(reinterpret_cast<const __m128i*>(buffer));
+            __m128i out_of_range = _mm_or_si128(
+                _mm_cmplt_epi8(chars, _mm_set1_epi8('0')),
+                _mm_cmpgt_epi8(chars, _mm_set1_epi8('9'))
+            );
+            if (_mm_movemask_epi8(out_of_range) != 0) {
+                return false;
+            }
+
+            __m128i digits = _mm_sub_epi8(chars, _mm_set1_epi8('0'));
+            __m128i pairs = _mm_maddubs_epi16(digits, _mm_set1_epi16(0x010A));
+            __m128i quads = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00010064));
+            __m128i packed = _mm_packs_epi32(quads, quads);
+            __m128i octets = _mm_madd_epi16(packed, _mm_set1_epi32(0x00012710));
+
+            first_value = static_cast<uint32_t>(_mm_cvtsi128_si32(octets));
+            second_value = static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_srli_si128(octets, 4)));
+            return true;
+        }
+
+        bool TryParsePair(std::string_view first, std::string_view second, int& first_value, int& second_value) {
+            Digits first_split;
+            Digits second_split;
+            if (!SplitSign(first, first_split) || !SplitSign(second, second_split)
+                || first_split.digits.size() > kMaxShortDigits || second_split.digits.size() > kMaxShortDigits) {
+                return false;
+            }
+            uint32_t first_raw;
+            uint32_t second_raw;
+            if (!ConvertPair(first_split.digits, second_split.digits, first_raw, second_raw)) {
+                return false;
+            }
+            first_value = first_split.negative ? -static_cast<int>(first_raw) : static_cast<int>(first_raw);
+            second_value = second_split.negative ? -static_cast<int>(second_raw) : static_cast<int>(second_raw);
+            return true;
+        }
+#endif
+    }
+
+    IntegerStatus ParseInteger(std::string_view token, int& value) noexcept {
+        Digits split;
+        if (SplitSign(token, split) && TryParseSwar(split, value)) {
+            return IntegerStatus::kOk;
+        }
+        return ParseIntegerSlow(token, value);
+    }
+
+    size_t ParseIntegers(const std::string_view* tokens, size_t count, int* values, IntegerStatus& status) noexcept {
+        status = IntegerStatus::kOk;
+        size_t i = 0;
+#ifdef ARGPARSER_SSSE3_KERNEL
+        if (HasSsse3()) {
+            while (i + 1 < count) {
+                if (TryParsePair(tokens[i], tokens[i + 1], values[i], values[i + 1])) {
+                    i += 2;
+                    continue;
+                }
+                status = ParseInteger(tokens[i], values[i]);
+                if (status != IntegerStatus::kOk) {
+                    return i;
+                }
+                i++;
+            }
+        }
+#endif
+        for (; i < count; i++) {
+            status = ParseInteger(tokens[i], values[i]);
+            if (status != IntegerStatus::kOk) {
+                return i;
+            }
+        }
+        return count;
+    }
+
+} // namespace ArgumentParser
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+namespace ArgumentParser {
+    enum class IntegerStatus {
+        kOk, kInvalid, kOutOfRange
+    };
+
+    // Whole-token conversion: an optional sign followed by decimal digits only,
+    // no whitespace and no trailing characters.
+    IntegerStatus ParseInteger(std::string_view token, int& value) noexcept;
+
+    // Converts tokens[0, count) into values[0, count). Returns the index of the
+    // first token that failed (its reason goes to status) or count on success.
+    size_t ParseIntegers(const std::string_view* tokens, size_t count, int* values, IntegerStatus& status) noexcept;
+
+} // namespace ArgumentParser
@@ -0,0 +1,205 @@
+#include "KeyTable.h"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+namespace ArgumentParser {
+
+    namespace {
+        constexpr uint64_t kMaxSeeds = 16;
+        constexpr uint32_t kMaxFirstDisplacement = 256;
+        constexpr uint32_t kSecondDisplacementLimit = 1 << 16;
+
+        // Levenshtein distance limited to a band of width 2 * bound + 1;
+        // anything above bound comes back as bound + 1.
+        size_t BoundedDistance(std::string_view first, std::string_view second, size_t bound,
+                               std::vector<size_t>& previous, std::vector<size_t>& current) {
+            const size_t kOver = bound + 1;
+            previous.assign(second.size() + 1, kOver);
+            current.assign(second.size() + 1, kOver);
+            for (size_t j = 0; j <= std::min(second.size(), bound); j++) {
+                previous[j] = j;
+            }
+            for (size_t i = 1; i <= first.size(); i++) {
+                size_t begin = i > bound ? i - bound : 1;
+                size_t end = std::min(second.size(), i + bound);
+                // The row still holds the one two rows back; of the cells
+                // outside the band only the two next to it are read.
+                current[begin - 1] = kOver;
+                if (end < second.size()) {
+                    current[end + 1] = kOver;
+                }
+                current[0] = i <= bound ? i : kOver;
+                size_t row_minimum = current[0];
+                for (size_t j = begin; j <= end; j++) {
+                    size_t substitution = previous[j - 1] + (first[i - 1] != second[j - 1]);
+                    size_t distance = std::min({substitution, previous[j] + 1, current[j - 1] + 1, kOver});
+                    current[j] = distance;
+                    row_minimum = std::min(row_minimum, distance);
+                }
+                if (row_minimum > bound) {
+                    return kOver;
+                }
+                std::swap(previous, current);
+            }
+            return std::min(previous[second.size()], kOver);
+        }
+    }
+
+    uint64_t KeyTable::Hash(std::string_view key, uint64_t seed) noexcept {
+        uint64_t hash = 14695981039346656037ull ^ (seed * 0x9e3779b97f4a7c15ull);
+        for (unsigned char c : key) {
+            hash ^= c;
+            hash *= 1099511628211ull;
+        }
+        hash ^= hash >> 33;
+        hash *= 0xff51afd7ed558ccdull;
+        hash ^= hash >> 33;
+        hash *= 0xc4ceb9fe1a85ec53ull;
+        hash ^= hash >> 33;
+        return hash;
+    }
+
+    uint64_t KeyTable::SlotIndex(uint64_t hash) const noexcept {
+        uint32_t displacement = displacements_[(hash >> 40) % displacements_.size()];
+        uint64_t first = static_cast<uint32_t>(hash);
+        uint64_t second = static_cast<uint32_t>(hash >> 32) | 1;
+        return (first + (displacement >> 16) * second + (displacement & 0xffff)) & mask_;
+    }
+
+    bool KeyTable::TryBuild(const std::vector<KeySlot>& entries) {
+        size_t capacity = 1;
+        while (capacity < entries.size() * 2) {
+            capacity <<= 1;
+        }
+        mask_ = capacity - 1;
+        slots_.assign(capacity, KeySlot());
+        displacements_.assign(entries.size() / 4 + 1, 0);
+
+        std::vector<uint64_t> hashes(entries.size());
+        std::vector<std::vector<uint32_t>> buckets(displacements_.size());
+        for (uint32_t i = 0; i < entries.size(); i++) {
+            hashes[i] = Hash(entries[i].name, seed_);
+            buckets[(hashes[i] >> 40) % buckets.size()].push_back(i);
+        }
+
+        std::vector<uint32_t> order(buckets.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&buckets](uint32_t lhs, uint32_t rhs) {
+            return buckets[lhs].size() > buckets[rhs].size();
+        });
+
+        std::vector<bool> taken(capacity, false);
+        std::vector<uint64_t> positions;
+        uint32_t second_limit = static_cast<uint32_t>(std::min<size_t>(capacity, kSecondDisplacementLimit));
+        for (uint32_t bucket : order) {
+            if (buckets[bucket].empty()) {
+                break;
+            }
+            bool placed = false;
+            for (uint32_t first = 0; first < kMaxFirstDisplacement && !placed; first++) {
+                for (uint32_t second = 0; second < second_limit && !placed; second++) {
+                    displacements_[bucket] = (first << 16) | second;
+                    positions.clear();
+                    placed = true;
+                    for (uint32_t entry : buckets[bucket]) {
+                        uint64_t position = SlotIndex(hashes[entry]);
+                        if (taken[position] || std::find(positions.begin(), positions.end(), position) != positions.end()) {
+                            placed = false;
+                            break;
+                        }
+                        positions.push_back(position);
+                    }
+                }
+            }
+            if (!placed) {
+                return false;
+            }
+            for (size_t i = 0; i < positions.size(); i++) {
+                taken[positions[i]] = true;
+                slots_[positions[i]] = entries[buckets[bucket][i]];
+            }
+        }
+        return true;
+    }
+
+    bool KeyTable::Build(const std::vector<KeySlot>& entries) {
+        for (seed_ = 0; seed_ < kMaxSeeds; seed_++) {
+            if (TryBuild(entries)) {
+                return true;
+            }
+        }
+        Clear();
+        return false;
+    }
+
+    void KeyTable::Clear() {
+        slots_.clear();
+        displacements_.clear();
+        mask_ = 0;
+    }
+
+    const KeySlot* KeyTable::Find(std::string_view key) const noexcept {
+        if (slots_.empty()) {
+            return nullptr;
+        }
+        const KeySlot& slot = slots_[SlotIndex(Hash(key, seed_))];
+        if (slot.name.empty() || slot.name != key) {
+            return nullptr;
+        }
+        return &slot;
+    }
+
+    void PrefixIndex::Build(const std::vector<KeySlot>& entries) {
+        slots_.clear();
+        for (const KeySlot& entry : entries) {
+            if (entry.name.size() > 1) {
+                slots_.push_back(entry);
+            }
+        }
+        std::sort(slots_.begin(), slots_.end(), [](const KeySlot& first, const KeySlot& second) {
+            return first.name < second.name;
+        });
+    }
+
+    void PrefixIndex::Clear() {
+        slots_.clear();
+    }
+
+    std::span<const KeySlot> PrefixIndex::Matches(std::string_view prefix) const noexcept {
+        auto begin = std::lower_bound(slots_.begin(), slots_.end(), prefix, [](const KeySlot& slot, std::string_view key) {
+            return slot.name < key;
+        });
+        auto end = std::partition_point(begin, slots_.end(), [prefix](const KeySlot& slot) {
+            return slot.name.starts_with(prefix);
+        });
+        return {begin, end};
+    }
+
+    const KeySlot* PrefixIndex::Closest(std::string_view key) const {
+        size_t bound = key.size() <= 4 ? 1 : 2;
+        if (key.size() <= bound) {
+            return nullptr;
+        }
+        const KeySlot* closest = nullptr;
+        size_t best = std::numeric_limits<size_t>::max();
+        std::vector<size_t> previous;
+        std::vector<size_t> current;
+        for (const KeySlot& slot : slots_) {
+            size_t length_difference = slot.name.size() > key.size() ? slot.name.size() - key.size()
+                                                                     : key.size() - slot.name.size();
+            if (length_difference > bound) {
+                continue;
+            }
+            size_t distance = BoundedDistance(key, slot.name, bound, previous, current);
+            if (distance <= bound && distance < best) {
+                best = distance;
+                closest = &slot;
+                bound = distance;
+            }
+        }
+        return closest;
+    }
+
+} // namespace ArgumentParser
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ArgumentParser {
+    template<typename T>
+    class Argument;
+
+    class Flag;
+
+    class ArgumentBase;
+
+    enum StoreType {
+        kIntArgument, kStringArgument, kValueArgument, kFlagArgument, kHelpArgument
+    };
+
+    struct KeySlot {
+        std::string_view name;
+        StoreType type = kFlagArgument;
+        uint32_t index = 0;
+        union {
+            Argument<int>* int_argument;
+            Argument<std::string>* string_argument;
+            ArgumentBase* argument;
+            Flag* flag;
+        };
+
+        KeySlot() : flag(nullptr) {}
+    };
+
+    // Flat perfect-hash table (hash and displace): every key costs one hash,
+    // one displacement read and one string compare.
+    class KeyTable {
+     private:
+        std::vector<KeySlot> slots_;
+        std::vector<uint32_t> displacements_;
+        uint64_t seed_ = 0;
+        uint64_t mask_ = 0;
+
+        [[nodiscard]] static uint64_t Hash(std::string_view key, uint64_t seed) noexcept;
+
+        [[nodiscard]] uint64_t SlotIndex(uint64_t hash) const noexcept;
+
+        bool TryBuild(const std::vector<KeySlot>& entries);
+     public:
+        bool Build(const std::vector<KeySlot>& entries);
+
+        void Clear();
+
+        [[nodiscard]] const KeySlot* Find(std::string_view key) const noexcept;
+
+        [[nodiscard]] size_t Capacity() const noexcept {
+            return slots_.size();
+        }
+    };
+
+    // Keys longer than one character in sorted order. An abbreviation costs
+    // one binary search; a miss is compared only against keys of similar
+    // length, with a banded edit distance that stops as soon as it exceeds
+    // the bound.
+    class PrefixIndex {
+     private:
+        std::vector<KeySlot> slots_;
+     public:
+        void Build(const std::vector<KeySlot>& entries);
+
+        void Clear();
+
+        // Every key that starts with prefix.
+        [[nodiscard]] std::span<const KeySlot> Matches(std::string_view prefix) const noexcept;
+
+        // The nearest key at most two edits (one for keys of up to four
+        // characters) away from key, nullptr if there's none.
+        [[nodiscard]] const KeySlot* Closest(std::string_view key) const;
+    };
+
+} // namespace ArgumentParser
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+
+namespace ArgumentParser {
+#ifdef ARGPARSER_INSTRUMENTATION
+    inline constexpr bool kInstrumentation = true;
+#else
+    inline constexpr bool kInstrumentation = false;
+#endif
+
+    // Counters of one parse. They are only collected when the library is built
+    // with ARGPARSER_INSTRUMENTATION, otherwise every field stays zero.
+    struct ParseStats {
+        uint64_t positional_tokens = 0;
+        uint64_t short_tokens = 0;      // -k and -abc clusters
+        uint64_t long_tokens = 0;       // --key
+        uint64_t equals_tokens = 0;     // -k=value and --key=value
+        uint64_t value_tokens = 0;      // values that follow a separate key
+
+        uint64_t lookups = 0;
+        uint64_t lookup_misses = 0;
+        // Heap allocations made by the parser itself while storing values.
+        uint64_t allocations = 0;
+        uint64_t exceptions = 0;
+
+        std::chrono::nanoseconds schema_build{0};   // the last Freeze()
+        std::chrono::nanoseconds tokenize{0};
+        std::chrono::nanoseconds convert{0};
+        std::chrono::nanoseconds check_correctness{0};
+    };
+
+    using StatsCallback = std::function<void(const ParseStats&)>;
+
+} // namespace ArgumentParser
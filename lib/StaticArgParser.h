@@ -0,0 +1,495 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "ArgParser.h"
+#include "IntegerParsing.h"
+
+// Compile-time counterpart of ArgParser: the whole schema is a type, the key
+// lookup is a perfect-hash table computed by the compiler and the parsed values
+// live in a plain tuple, so nothing is built at startup.
+//
+//     using Parser = Static::StaticArgParser<
+//         Static::Int<"N", Static::Positional, Static::MinValues<1>>,
+//         Static::Flag<"sum">,
+//         Static::Help<'h', "help">>;
+namespace ArgumentParser::Static {
+    template<size_t N>
+    struct FixedString {
+        char data[N]{};
+
+        constexpr FixedString(const char (&text)[N]) {
+            std::copy_n(text, N, data);
+        }
+
+        [[nodiscard]] constexpr std::string_view View() const {
+            return {data, N - 1};
+        }
+    };
+
+    struct Positional {};
+
+    struct Multi {};
+
+    template<uint64_t N>
+    struct MinValues {};
+
+    template<char C>
+    struct Short {};
+
+    template<auto V>
+    struct Default {};
+
+    template<FixedString V>
+    struct DefaultString {};
+
+    enum class OptionKind {
+        kInt, kString, kFlag, kHelp
+    };
+
+    namespace detail {
+        template<typename T>
+        struct ShortOf {
+            static constexpr char value = 0;
+        };
+
+        template<char C>
+        struct ShortOf<Short<C>> {
+            static constexpr char value = C;
+        };
+
+        template<typename T>
+        struct MinOf {
+            static constexpr bool present = false;
+            static constexpr uint64_t value = 0;
+        };
+
+        template<uint64_t N>
+        struct MinOf<MinValues<N>> {
+            static constexpr bool present = true;
+            static constexpr uint64_t value = N;
+        };
+
+        template<typename Value, typename T>
+        struct DefaultOf {
+            static constexpr bool present = false;
+        };
+
+        template<typename Value, auto V>
+        struct DefaultOf<Value, Default<V>> {
+            static constexpr bool present = true;
+            static constexpr Value value = V;
+        };
+
+        template<FixedString V>
+        struct DefaultOf<std::string, DefaultString<V>> {
+            static constexpr bool present = true;
+            static constexpr std::string_view value = V.View();
+        };
+
+        template<typename Value, typename... Modifiers>
+        Value DefaultValue() {
+            Value result{};
+            ([&result] {
+                if constexpr (DefaultOf<Value, Modifiers>::present) {
+                    result = Value(DefaultOf<Value, Modifiers>::value);
+                }
+            }(), ...);
+            return result;
+        }
+
+        constexpr uint64_t Hash(std::string_view key, uint64_t seed) {
+            uint64_t hash = 14695981039346656037ull ^ (seed * 0x9e3779b97f4a7c15ull);
+            for (char c : key) {
+                hash ^= static_cast<unsigned char>(c);
+                hash *= 1099511628211ull;
+            }
+            hash ^= hash >> 33;
+            hash *= 0xff51afd7ed558ccdull;
+            hash ^= hash >> 33;
+            return hash;
+        }
+
+        template<size_t NumKeys>
+        struct PerfectHash {
+            static constexpr size_t kCapacity = std::bit_ceil(std::max<size_t>(NumKeys * 2, 1));
+            static constexpr size_t kBuckets = NumKeys / 4 + 1;
+
+            std::array<uint16_t, kCapacity> slots{};
+            std::array<uint32_t, kBuckets> displacements{};
+            uint64_t seed = 0;
+
+            [[nodiscard]] constexpr size_t Slot(uint64_t hash) const {
+                uint32_t displacement = displacements[(hash >> 40) % kBuckets];
+                uint64_t first = static_cast<uint32_t>(hash);
+                uint64_t second = static_cast<uint32_t>(hash >> 32) | 1;
+                return (first + (displacement >> 16) * second + (displacement & 0xffff)) & (kCapacity - 1);
+            }
+
+            // slots hold key index + 1, zero marks an empty slot
+            constexpr bool TryBuild(const std::array<std::string_view, NumKeys>& keys) {
+                slots.fill(0);
+                displacements.fill(0);
+                std::array<uint64_t, NumKeys> hashes{};
+                std::array<size_t, kBuckets> sizes{};
+                for (size_t i = 0; i < NumKeys; i++) {
+                    hashes[i] = Hash(keys[i], seed);
+                    sizes[(hashes[i] >> 40) % kBuckets]++;
+                }
+                std::array<size_t, kBuckets> order{};
+                for (size_t i = 0; i < kBuckets; i++) {
+                    order[i] = i;
+                }
+                for (size_t i = 1; i < kBuckets; i++) {
+                    for (size_t j = i; j > 0 && sizes[order[j - 1]] < sizes[order[j]]; j--) {
+                        std::swap(order[j - 1], order[j]);
+                    }
+                }
+                for (size_t bucket : order) {
+                    if (sizes[bucket] == 0) {
+                        break;
+                    }
+                    bool placed = false;
+                    for (uint32_t displacement = 0; displacement < kCapacity * kCapacity && !placed; displacement++) {
+                        displacements[bucket] = ((displacement / kCapacity) << 16) | (displacement % kCapacity);
+                        placed = true;
+                        for (size_t i = 0; i < NumKeys && placed; i++) {
+                            if ((hashes[i] >> 40) % kBuckets != bucket) {
+                                continue;
+                            }
+                            size_t slot = Slot(hashes[i]);
+                            if (slots[slot] != 0) {
+                                placed = false;
+                            }
+                            for (size_t j = 0; j < i && placed; j++) {
+                                if ((hashes[j] >> 40) % kBuckets == bucket && Slot(hashes[j]) == slot) {
+                                    placed = false;
+                                }
+                            }
+                        }
+                    }
+                    if (!placed) {
+                        return false;
+                    }
+                    for (size_t i = 0; i < NumKeys; i++) {
+                        if ((hashes[i] >> 40) % kBuckets == bucket) {
+                            slots[Slot(hashes[i])] = static_cast<uint16_t>(i + 1);
+                        }
+                    }
+                }
+                return true;
+            }
+
+            static constexpr PerfectHash Build(const std::array<std::string_view, NumKeys>& keys) {
+                PerfectHash table;
+                for (size_t i = 0; i < NumKeys; i++) {
+                    for (size_t j = 0; j < i; j++) {
+                        if (keys[i] == keys[j]) {
+                            return table;
+                        }
+                    }
+                }
+                while (!table.TryBuild(keys)) {
+                    table.seed++;
+                }
+                return table;
+            }
+        };
+    }
+
+    template<OptionKind Kind, typename T, FixedString Name, typename... Modifiers>
+    struct Option {
+        static constexpr OptionKind kKind = Kind;
+        static constexpr std::string_view kName = Name.View();
+        static constexpr char kShort = (detail::ShortOf<Modifiers>::value | ... | 0);
+        static constexpr char kShortName[2] = {kShort, '\0'};
+        static constexpr bool kPositional = (std::is_same_v<Modifiers, Positional> || ...);
+        static constexpr bool kMultiValue =
+            (std::is_same_v<Modifiers, Multi> || ...) || (detail::MinOf<Modifiers>::present || ...);
+        static constexpr uint64_t kMinValues = kMultiValue ? (detail::MinOf<Modifiers>::value | ... | 0) : 1;
+        static constexpr bool kHasDefault = (detail::DefaultOf<T, Modifiers>::present || ...);
+
+        using Value = T;
+        using Storage = std::conditional_t<kMultiValue, std::vector<T>, T>;
+
+        static_assert(!kName.empty(), "Option needs a long name");
+        static_assert(!(kMultiValue && kHasDefault), "Defaults are only supported for single-value options");
+
+        static Storage Initial() {
+            if constexpr (kHasDefault) {
+                return Storage(detail::DefaultValue<T, Modifiers...>());
+            } else {
+                return Storage{};
+            }
+        }
+    };
+
+    template<FixedString Name, typename... Modifiers>
+    using Int = Option<OptionKind::kInt, int, Name, Modifiers...>;
+
+    template<FixedString Name, typename... Modifiers>
+    using String = Option<OptionKind::kString, std::string, Name, Modifiers...>;
+
+    template<FixedString Name, typename... Modifiers>
+    using Flag = Option<OptionKind::kFlag, bool, Name, Modifiers...>;
+
+    template<char ShortKey, FixedString Name>
+    using Help = Option<OptionKind::kHelp, bool, Name, Short<ShortKey>>;
+
+    template<typename... Options>
+    class StaticArgParser {
+     private:
+        static constexpr size_t kOptions = sizeof...(Options);
+        static constexpr size_t kKeys = kOptions + (0 + ... + (Options::kShort != 0));
+
+        static constexpr std::array<OptionKind, kOptions> kKinds = {Options::kKind...};
+        static constexpr std::array<bool, kOptions> kMultiValue = {Options::kMultiValue...};
+        static constexpr std::array<std::string_view, kOptions> kNames = {Options::kName...};
+
+        struct Keys {
+            std::array<std::string_view, kKeys> names{};
+            std::array<uint16_t, kKeys> options{};
+        };
+
+        static constexpr Keys MakeKeys() {
+            Keys keys;
+            size_t count = 0;
+            size_t option = 0;
+            auto add = [&](std::string_view long_name, char short_key, std::string_view short_name) {
+                keys.names[count] = long_name;
+                keys.options[count++] = static_cast<uint16_t>(option);
+                if (short_key != 0) {
+                    keys.names[count] = short_name;
+                    keys.options[count++] = static_cast<uint16_t>(option);
+                }
+                option++;
+            };
+            (add(Options::kName, Options::kShort, {Options::kShortName, 1}), ...);
+            return keys;
+        }
+
+        static constexpr Keys kKeyList = MakeKeys();
+        static constexpr auto kTable = detail::PerfectHash<kKeys>::Build(kKeyList.names);
+
+        static constexpr bool HasUniqueKeys() {
+            for (size_t i = 0; i < kKeys; i++) {
+                for (size_t j = 0; j < i; j++) {
+                    if (kKeyList.names[i] == kKeyList.names[j]) {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+
+        static_assert(HasUniqueKeys(), "Duplicate keys in StaticArgParser schema");
+
+        static constexpr size_t kPositionals = (0 + ... + Options::kPositional);
+
+        static constexpr std::array<uint16_t, kPositionals> MakePositionals() {
+            std::array<uint16_t, kPositionals> positionals{};
+            size_t count = 0;
+            size_t option = 0;
+            auto add = [&](bool positional) {
+                if (positional) {
+                    positionals[count++] = static_cast<uint16_t>(option);
+                }
+                option++;
+            };
+            (add(Options::kPositional), ...);
+            return positionals;
+        }
+
+        static constexpr std::array<uint16_t, kPositionals> kPositionalOrder = MakePositionals();
+
+        std::tuple<typename Options::Storage...> values_{Options::Initial()...};
+        std::array<uint64_t, kOptions> counts_{};
+        size_t positional_cursor_ = 0;
+        size_t token_index_ = 0;
+
+        static constexpr int Find(std::string_view key) {
+            uint16_t slot = kTable.slots[kTable.Slot(detail::Hash(key, kTable.seed))];
+            if (slot == 0 || kKeyList.names[slot - 1] != key) {
+                return -1;
+            }
+            return kKeyList.options[slot - 1];
+        }
+
+        template<FixedString Name>
+        static constexpr size_t IndexOf() {
+            for (size_t i = 0; i < kOptions; i++) {
+                if (kNames[i] == Name.View()) {
+                    return i;
+                }
+            }
+            return kOptions;
+        }
+
+        template<size_t I>
+        void Store(std::string_view value) {
+            using Selected = std::tuple_element_t<I, std::tuple<Options...>>;
+            auto& storage = std::get<I>(values_);
+            if constexpr (Selected::kKind == OptionKind::kFlag || Selected::kKind == OptionKind::kHelp) {
+                storage = true;
+            } else if constexpr (Selected::kKind == OptionKind::kInt) {
+                int converted;
+                IntegerStatus status = ParseInteger(value, converted);
+                if (status != IntegerStatus::kOk) {
+                    std::string reason = status == IntegerStatus::kOutOfRange ? "is out of range" : "is not an integer";
+                    throw parse_exception("Value [" + std::string(value) + "] of argument [" + std::string(Selected::kName)
+                                              + "] " + reason + " (token " + std::to_string(token_index_) + ")");
+                }
+                if constexpr (Selected::kMultiValue) {
+                    storage.push_back(converted);
+                } else {
+                    storage = converted;
+                }
+            } else {
+                if constexpr (Selected::kMultiValue) {
+                    storage.emplace_back(value);
+                } else {
+                    storage = value;
+                }
+            }
+            counts_[I]++;
+        }
+
+        using Setter = void (StaticArgParser::*)(std::string_view);
+
+        template<size_t... Is>
+        static constexpr std::array<Setter, kOptions> MakeSetters(std::index_sequence<Is...>) {
+            return {&StaticArgParser::Store<Is>...};
+        }
+
+        static constexpr std::array<Setter, kOptions> kSetters = MakeSetters(std::index_sequence_for<Options...>{});
+
+        static bool TakesValue(int option) {
+            return kKinds[option] == OptionKind::kInt || kKinds[option] == OptionKind::kString;
+        }
+
+        int FindKey(std::string_view key) const {
+            int option = Find(key);
+            if (option < 0) {
+                throw parse_exception("There's no such argument as [" + std::string(key) + "]");
+            }
+            return option;
+        }
+
+        void SetValue(int option, std::string_view value) {
+            if (!TakesValue(option)) {
+                throw parse_exception("Flag [" + std::string(kNames[option]) + "] doesn't take a value");
+            }
+            (this->*kSetters[option])(value);
+        }
+
+        void SetPositional(std::string_view value) {
+            while (positional_cursor_ < kPositionals) {
+                uint16_t option = kPositionalOrder[positional_cursor_];
+                if (kMultiValue[option] || counts_[option] == 0) {
+                    SetValue(option, value);
+                    return;
+                }
+                positional_cursor_++;
+            }
+            throw parse_exception("Unexpected positional argument [" + std::string(value) + "]");
+        }
+
+        template<size_t... Is>
+        [[nodiscard]] bool CheckCorrectness(std::index_sequence<Is...>) const {
+            return ((Options::kKind == OptionKind::kFlag || Options::kKind == OptionKind::kHelp
+                || counts_[Is] >= Options::kMinValues || (counts_[Is] == 0 && Options::kHasDefault)) && ...);
+        }
+
+        template<typename Iterator>
+        bool ParseTokens(Iterator begin, Iterator end) {
+            positional_cursor_ = 0;
+            token_index_ = 0;
+            for (auto it = begin; it != end; ++it) {
+                std::string_view token = *it;
+                token_index_++;
+                if (token.size() < 2 || token[0] != '-') {
+                    SetPositional(token);
+                    continue;
+                }
+                size_t name_begin = (token[1] == '-') + 1;
+                size_t equal_sign = token.find('=');
+                if (equal_sign != std::string_view::npos) {
+                    SetValue(FindKey(token.substr(name_begin, equal_sign - name_begin)), token.substr(equal_sign + 1));
+                    continue;
+                }
+                if (name_begin == 1 && token.length() > 2) {
+                    for (size_t i = 1; i < token.length(); i++) {
+                        int option = Find(token.substr(i, 1));
+                        if (option < 0 || TakesValue(option)) {
+                            throw parse_exception("Not excepted flag: [" + std::string(token.substr(i, 1)) + "]");
+                        }
+                        (this->*kSetters[option])({});
+                    }
+                    continue;
+                }
+                int option = FindKey(token.substr(name_begin));
+                if (!TakesValue(option)) {
+                    (this->*kSetters[option])({});
+                    continue;
+                }
+                if (std::next(it) == end) {
+                    throw parse_exception("Not enough values");
+                }
+                ++it;
+                token_index_++;
+                SetValue(option, *it);
+            }
+            return CheckCorrectness(std::index_sequence_for<Options...>{});
+        }
+
+     public:
+        bool Parse(const std::vector<std::string>& data) {
+            return data.empty() ? CheckCorrectness(std::index_sequence_for<Options...>{})
+                                : ParseTokens(data.begin() + 1, data.end());
+        }
+
+        bool Parse(std::span<const std::string_view> data) {
+            return data.empty() ? CheckCorrectness(std::index_sequence_for<Options...>{})
+                                : ParseTokens(data.begin() + 1, data.end());
+        }
+
+        bool Parse(int argc, char** argv) {
+            return argc < 1 ? CheckCorrectness(std::index_sequence_for<Options...>{})
+                            : ParseTokens(argv + 1, argv + argc);
+        }
+
+        template<FixedString Name>
+        [[nodiscard]] const auto& Get() const {
+            constexpr size_t kIndex = IndexOf<Name>();
+            static_assert(kIndex < kOptions, "There's no such option in the schema");
+            return std::get<kIndex>(values_);
+        }
+
+        template<FixedString Name>
+        [[nodiscard]] uint64_t Count() const {
+            constexpr size_t kIndex = IndexOf<Name>();
+            static_assert(kIndex < kOptions, "There's no such option in the schema");
+            return counts_[kIndex];
+        }
+
+        [[nodiscard]] bool Help() const {
+            for (size_t i = 0; i < kOptions; i++) {
+                if (kKinds[i] == OptionKind::kHelp && counts_[i] != 0) {
+                    return true;
+                }
+            }
+            return false;
+        }
+    };
+
+} // namespace ArgumentParser::Static
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <charconv>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace ArgumentParser {
+    // Turns one token into a T. Specialize it for your own types with
+    //     static bool Parse(std::string_view token, T& value);
+    // returning false when the token isn't a valid T.
+    template<typename T>
+    struct ValueConverter;
+
+    // Names of an enum's values for ValueConverter, e.g.
+    //     template<> struct EnumNames<Mode> {
+    //         static constexpr std::pair<std::string_view, Mode> kNames[] = {{"fast", Mode::kFast}, ...};
+    //     };
+    template<typename E>
+    struct EnumNames;
+
+    template<typename T> requires std::is_arithmetic_v<T> && (!std::is_same_v<T, bool>)
+    struct ValueConverter<T> {
+        static bool Parse(std::string_view token, T& value) {
+            if (token.starts_with('+')) {
+                token.remove_prefix(1);
+                if (token.starts_with('-')) {
+                    return false;
+                }
+            }
+            auto [end, error] = std::from_chars(token.data(), token.data() + token.size(), value);
+            return error == std::errc() && end == token.data() + token.size() && !token.empty();
+        }
+    };
+
+    template<typename E> requires std::is_enum_v<E>
+    struct ValueConverter<E> {
+        static bool Parse(std::string_view token, E& value) {
+            for (const auto& [name, named_value] : EnumNames<E>::kNames) {
+                if (name == token) {
+                    value = named_value;
+                    return true;
+                }
+            }
+            return false;
+        }
+    };
+
+    template<>
+    struct ValueConverter<std::string> {
+        static bool Parse(std::string_view token, std::string& value) {
+            value = token;
+            return true;
+        }
+    };
+
+} // namespace ArgumentParser
@@ -1,6 +1,13 @@
 #include <lib/ArgParser.h>
+#include <lib/IntegerParsing.h>
+#include <lib/StaticArgParser.h>
 #include <gtest/gtest.h>
+#include <fstream>
 #include <sstream>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <thread>
 
 using namespace ArgumentParser;
 
@@ -10,6 +17,58 @@ std::vector<std::string> SplitString(const std::string& str) {
     return {std::istream_iterator<std::string>(iss), std::istream_iterator<std::string>()};
 }
 
+// Counts every operator new of the test binary, pmr resources included.
+std::atomic<size_t> global_allocations{0};
+
+void* operator new(size_t size) {
+    global_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* pointer = std::malloc(size == 0 ? 1 : size)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+    global_allocations.fetch_add(1, std::memory_order_relaxed);
+    auto align = static_cast<size_t>(alignment);
+    if (void* pointer = std::aligned_alloc(align, (size + align - 1) / align * align)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return operator new(size);
+    } catch (const std::bad_alloc&) {
+        return nullptr;
+    }
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    try {
+        return operator new(size, alignment);
+    } catch (const std::bad_alloc&) {
+        return nullptr;
+    }
+}
+
+void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept {
+    std::free(pointer);
+}
+
 TEST(ArgParserTestSuite, EmptyTest) {
     ArgParser parser("My Empty Parser");
 
@@ -47,6 +106,102 @@ TEST(ArgParserTestSuite, NoDefaultTest) {
     ASSERT_FALSE(parser.Parse(SplitString("app")));
 }
 
+TEST(ArgParserTestSuite, OptionalTest) {
+    ArgParser parser("My Parser");
+    std::string output;
+    parser.AddStringArgument('o', "output").Optional().StoreValue(output);
+    parser.AddFlag('v', "verbose");
+
+    ASSERT_TRUE(parser.Parse(SplitString("app")));
+    ASSERT_FALSE(parser.Has("output"));
+    ASSERT_FALSE(parser.Has("verbose"));
+
+    parser.Reset();
+    ASSERT_TRUE(parser.Parse(SplitString("app -o= -v")));
+    ASSERT_TRUE(parser.Has("output"));
+    ASSERT_TRUE(output.empty());
+    ASSERT_TRUE(parser.Has("verbose"));
+    ASSERT_THROW(parser.AddIntArgument("list").MultiValue().Optional(), settings_exception);
+}
+
+TEST(ArgParserTestSuite, OptionalValuesTest) {
+    ArgParser parser("My Parser");
+    parser.AddStringArgument('o', "output").Optional();
+    IntHandle level = parser.AddIntArgument("level").Optional().Handle();
+    parser.AddArgument<double>("ratio").Optional();
+    parser.AddIntArgument("required");
+    parser.AddHelp('h', "help", "Optional test");
+    parser.Freeze();
+
+    ASSERT_NE(parser.HelpDescription().find("--output=<string>  [optional]"), std::string_view::npos);
+
+    ParseResult result = parser.ParseToResult(SplitString("app"));
+    ASSERT_FALSE(result.IsCorrect());
+    ASSERT_EQ(result.GetStringValue("output"), "");
+    ASSERT_EQ(result.GetStringView("output"), "");
+    ASSERT_EQ(result.GetIntValue("level"), 0);
+    ASSERT_EQ(result.Get(level), 0);
+    ASSERT_EQ(result.GetValue<double>("ratio"), 0.0);
+    ASSERT_THROW((void) result.GetIntValue("required"), parse_exception);
+
+    ASSERT_FALSE(parser.Parse(SplitString("app")));
+    ASSERT_EQ(parser.GetStringValue("output"), "");
+    ASSERT_EQ(parser.GetIntValue("level"), 0);
+    ASSERT_EQ(parser.GetValue<double>("ratio"), 0.0);
+    ASSERT_THROW(parser.GetIntValue("required"), parse_exception);
+
+    result = parser.ParseToResult(SplitString("app -o out --level=3 --ratio=0.5 --required=1"));
+    ASSERT_TRUE(result.IsCorrect());
+    ASSERT_EQ(result.GetStringValue("output"), "out");
+    ASSERT_EQ(result.Get(level), 3);
+    ASSERT_EQ(result.GetValue<double>("ratio"), 0.5);
+}
+
+TEST(ArgParserTestSuite, HasTest) {
+    setenv("HASTEST_THREADS", "4", 1);
+    ArgParser parser("My Parser");
+    parser.AddStringArgument('o', "output").Optional();
+    parser.AddIntArgument("threads").Default(1);
+    parser.AddIntArgument('n', "numbers").MultiValue();
+    parser.AddFlag('v', "verbose");
+    parser.AddHelp('h', "help", "Has test");
+    parser.SetEnvPrefix("HASTEST_");
+    parser.Freeze();
+
+    ParseResult result = parser.ParseToResult(SplitString("app -n 1 -o x"));
+    ASSERT_TRUE(result.Has("output"));
+    ASSERT_TRUE(result.Has("o"));
+    ASSERT_TRUE(result.Has("threads"));
+    ASSERT_TRUE(result.Has("numbers"));
+    ASSERT_FALSE(result.Has("verbose"));
+    ASSERT_FALSE(result.Has("help"));
+    ASSERT_THROW((void) result.Has("missing"), parse_exception);
+
+    ASSERT_TRUE(parser.Parse(SplitString("app -n 1 -o x")));
+    ASSERT_TRUE(parser.Has("output"));
+    ASSERT_TRUE(parser.Has("threads"));
+    ASSERT_FALSE(parser.Has("verbose"));
+    ASSERT_FALSE(parser.Has("help"));
+    ASSERT_THROW(parser.Has("missing"), parse_exception);
+    unsetenv("HASTEST_THREADS");
+
+    result = parser.ParseToResult(SplitString("app -v -h"));
+    ASSERT_FALSE(result.Has("output"));
+    ASSERT_FALSE(result.Has("threads"));
+    ASSERT_EQ(result.GetIntValue("threads"), 1);
+    ASSERT_FALSE(result.Has("numbers"));
+    ASSERT_TRUE(result.Has("verbose"));
+    ASSERT_TRUE(result.Has("help"));
+
+    parser.Reset();
+    ASSERT_TRUE(parser.Parse(SplitString("app -v -h")));
+    ASSERT_FALSE(parser.Has("output"));
+    ASSERT_FALSE(parser.Has("threads"));
+    ASSERT_FALSE(parser.Has("numbers"));
+    ASSERT_TRUE(parser.Has("verbose"));
+    ASSERT_TRUE(parser.Has("h"));
+}
+
 TEST(ArgParserTestSuite, StoreValueTest) {
     ArgParser parser("My Parser");
     std::string value;
@@ -156,3 +311,1137 @@ TEST(ArgParserTestSuite, HelpStringTest) {
     //     "-h, --help Display this help and exit\n"
     // );
 }
+
+TEST(ArgParserTestSuite, StringViewSpanTest) {
+    ArgParser parser("My Parser");
+    std::vector<int> values;
+    parser.AddIntArgument("Param1").MultiValue(1).Positional().StoreValues(values);
+    parser.AddStringArgument('s', "str");
+    parser.AddFlag('f', "flag");
+
+    std::string_view data[] = {"app", "-s", "value", "1", "--flag", "2", "3"};
+
+    ASSERT_TRUE(parser.Parse(std::span<const std::string_view>(data)));
+    ASSERT_EQ(parser.GetStringValue("str"), "value");
+    ASSERT_TRUE(parser.GetFlag("flag"));
+    ASSERT_EQ(values, std::vector<int>({1, 2, 3}));
+}
+
+TEST(ArgParserTestSuite, ArgvTest) {
+    ArgParser parser("My Parser");
+    parser.AddStringArgument('p', "param1");
+    parser.AddIntArgument("param2");
+
+    char arg0[] = "app";
+    char arg1[] = "--param1=value1";
+    char arg2[] = "--param2";
+    char arg3[] = "42";
+    char* argv[] = {arg0, arg1, arg2, arg3};
+
+    ASSERT_TRUE(parser.Parse(4, argv));
+    ASSERT_EQ(parser.GetStringValue("param1"), "value1");
+    ASSERT_EQ(parser.GetIntValue("param2"), 42);
+}
+
+TEST(ArgParserTestSuite, ManyKeysTest) {
+    ArgParser parser("My Parser");
+    for (int i = 0; i < 2000; i++) {
+        parser.AddIntArgument("param" + std::to_string(i)).Default(-1);
+    }
+    parser.AddFlag('f', "flag");
+    parser.Freeze();
+
+    ASSERT_TRUE(parser.Parse(SplitString("app --param0=0 --param1999 1999 -f --param777=777")));
+    ASSERT_EQ(parser.GetIntValue("param0"), 0);
+    ASSERT_EQ(parser.GetIntValue("param777"), 777);
+    ASSERT_EQ(parser.GetIntValue("param1999"), 1999);
+    ASSERT_EQ(parser.GetIntValue("param1000"), -1);
+    ASSERT_TRUE(parser.GetFlag("flag"));
+}
+
+TEST(ArgParserTestSuite, KeyTableTest) {
+    std::vector<std::string> names;
+    for (int i = 0; i < 5000; i++) {
+        names.push_back("key" + std::to_string(i * 7919));
+    }
+    std::vector<KeySlot> entries(names.size());
+    for (size_t i = 0; i < names.size(); i++) {
+        entries[i].name = names[i];
+    }
+
+    KeyTable table;
+    ASSERT_TRUE(table.Build(entries));
+    for (const auto& name : names) {
+        const KeySlot* slot = table.Find(name);
+        ASSERT_NE(slot, nullptr);
+        ASSERT_EQ(slot->name, name);
+    }
+    ASSERT_EQ(table.Find("key1"), nullptr);
+    ASSERT_EQ(table.Find(""), nullptr);
+}
+
+TEST(ArgParserTestSuite, UnknownKeyTest) {
+    ArgParser parser("My Parser");
+    parser.AddFlag('a', "flag1");
+
+    ASSERT_THROW(parser.Parse(SplitString("app --flag2")), parse_exception);
+    ASSERT_THROW(parser.Parse(SplitString("app -ab")), parse_exception);
+}
+
+TEST(ArgParserTestSuite, RegisterAfterParseTest) {
+    ArgParser parser("My Parser");
+    parser.AddFlag('a', "flag1");
+    ASSERT_TRUE(parser.Parse(SplitString("app -a")));
+
+    parser.AddStringArgument("param1");
+    ASSERT_TRUE(parser.Parse(SplitString("app --param1=value1")));
+    ASSERT_EQ(parser.GetStringValue("param1"), "value1");
+}
+
+TEST(ArgParserTestSuite, PositionalOrderTest) {
+    ArgParser parser("My Parser");
+    std::vector<int> values;
+    parser.AddStringArgument("input").Positional();
+    parser.AddStringArgument('o', "output").Positional();
+    parser.AddIntArgument("Param1").MultiValue(1).Positional().StoreValues(values);
+
+    ASSERT_TRUE(parser.Parse(SplitString("app in.txt out.txt 1 2 3")));
+    ASSERT_EQ(parser.GetStringValue("input"), "in.txt");
+    ASSERT_EQ(parser.GetStringValue("output"), "out.txt");
+    ASSERT_EQ(values, std::vector<int>({1, 2, 3}));
+}
+
+TEST(ArgParserTestSuite, PositionalSkipsFilledTest) {
+    ArgParser parser("My Parser");
+    parser.AddStringArgument("input").Positional();
+    parser.AddStringArgument('o', "output").Positional();
+
+    ASSERT_TRUE(parser.Parse(SplitString("app --input=in.txt out.txt")));
+    ASSERT_EQ(parser.GetStringValue("input"), "in.txt");
+    ASSERT_EQ(parser.GetStringValue("output"), "out.txt");
+}
+
+TEST(ArgParserTestSuite, UnexpectedPositionalTest) {
+    ArgParser parser("My Parser");
+    parser.AddStringArgument("input").Positional();
+
+    ASSERT_THROW(parser.Parse(SplitString("app in.txt out.txt")), parse_exception);
+}
+
+TEST(ArgParserTestSuite, ParseIntegerTest) {
+    int value = 0;
+    ASSERT_EQ(ParseInteger("100500", value), IntegerStatus::kOk);
+    ASSERT_EQ(value, 100500);
+    ASSERT_EQ(ParseInteger("-2147483648", value), IntegerStatus::kOk);
+    ASSERT_EQ(value, -2147483648);
+    ASSERT_EQ(ParseInteger("+2147483647", value), IntegerStatus::kOk);
+    ASSERT_EQ(value, 2147483647);
+    ASSERT_EQ(ParseInteger("0000000000000000000042", value), IntegerStatus::kOk);
+    ASSERT_EQ(value, 42);
+
+    ASSERT_EQ(ParseInteger("2147483648", value), IntegerStatus::kOutOfRange);
+    ASSERT_EQ(ParseInteger("99999999999999999999", value), IntegerStatus::kOutOfRange);
+    ASSERT_EQ(ParseInteger("12abc", value), IntegerStatus::kInvalid);
+    ASSERT_EQ(ParseInteger(" 12", value), IntegerStatus::kInvalid);
+    ASSERT_EQ(ParseInteger("", value), IntegerStatus::kInvalid);
+    ASSERT_EQ(ParseInteger("-", value), IntegerStatus::kInvalid);
+    ASSERT_EQ(ParseInteger("+-1", value), IntegerStatus::kInvalid);
+}
+
+TEST(ArgParserTestSuite, ParseIntegersBatchTest) {
+    std::vector<std::string> storage;
+    for (int i = 0; i < 1000; i++) {
+        storage.push_back(std::to_string((i % 2 ? -1 : 1) * i * i * 2137));
+    }
+    storage.push_back("7");
+    std::vector<std::string_view> tokens(storage.begin(), storage.end());
+    std::vector<int> values(tokens.size());
+    IntegerStatus status;
+
+    ASSERT_EQ(ParseIntegers(tokens.data(), tokens.size(), values.data(), status), tokens.size());
+    for (size_t i = 0; i < tokens.size(); i++) {
+        ASSERT_EQ(values[i], std::stoi(storage[i]));
+    }
+
+    tokens[501] = "5x";
+    ASSERT_EQ(ParseIntegers(tokens.data(), tokens.size(), values.data(), status), 501);
+    ASSERT_EQ(status, IntegerStatus::kInvalid);
+}
+
+TEST(ArgParserTestSuite, InvalidIntegerTest) {
+    ArgParser parser("My Parser");
+    parser.AddIntArgument("param1");
+    std::vector<int> values;
+    parser.AddIntArgument("Param2").MultiValue().Positional().StoreValues(values);
+
+    try {
+        parser.Parse(SplitString("app --param1=12 1 2 3 4a 5"));
+        FAIL();
+    } catch (const parse_exception& exception) {
+        ASSERT_NE(std::string(exception.what()).find("[4a]"), std::string::npos);
+        ASSERT_NE(std::string(exception.what()).find("token 5"), std::string::npos);
+    }
+    ASSERT_THROW(parser.Parse(SplitString("app --param1 99999999999")), parse_exception);
+}
+
+TEST(StaticArgParserTestSuite, PositionalAndFlagsTest) {
+    using namespace ArgumentParser::Static;
+    StaticArgParser<
+        Int<"N", Positional, MinValues<1>>,
+        Static::Flag<"sum", Short<'s'>>,
+        Static::Flag<"mult", Short<'m'>>,
+        Help<'h', "help">
+    > parser;
+
+    ASSERT_TRUE(parser.Parse(SplitString("app 1 2 --sum 3")));
+    ASSERT_EQ(parser.Get<"N">(), std::vector<int>({1, 2, 3}));
+    ASSERT_TRUE(parser.Get<"sum">());
+    ASSERT_FALSE(parser.Get<"mult">());
+    ASSERT_FALSE(parser.Help());
+}
+
+TEST(StaticArgParserTestSuite, KeyFormsTest) {
+    using namespace ArgumentParser::Static;
+    StaticArgParser<
+        String<"input", Short<'i'>>,
+        String<"output", DefaultString<"out.txt">>,
+        Int<"level", Short<'l'>, Default<3>>,
+        Int<"count">,
+        Static::Flag<"flag1", Short<'a'>>,
+        Static::Flag<"flag2", Short<'b'>, Default<true>>,
+        Static::Flag<"flag3", Short<'c'>>
+    > parser;
+
+    ASSERT_TRUE(parser.Parse(SplitString("app -i=in.txt --count 10 -ac")));
+    ASSERT_EQ(parser.Get<"input">(), "in.txt");
+    ASSERT_EQ(parser.Get<"output">(), "out.txt");
+    ASSERT_EQ(parser.Get<"level">(), 3);
+    ASSERT_EQ(parser.Get<"count">(), 10);
+    ASSERT_TRUE(parser.Get<"flag1">());
+    ASSERT_TRUE(parser.Get<"flag2">());
+    ASSERT_TRUE(parser.Get<"flag3">());
+    ASSERT_EQ(parser.Count<"level">(), 0);
+}
+
+TEST(StaticArgParserTestSuite, CorrectnessTest) {
+    using namespace ArgumentParser::Static;
+    StaticArgParser<Int<"param1", Short<'p'>, MinValues<3>>, String<"param2">> parser;
+
+    ASSERT_FALSE(parser.Parse(SplitString("app --param1=1 -p 2 --param2=x")));
+    ASSERT_THROW(parser.Parse(SplitString("app --param3=1")), parse_exception);
+    ASSERT_THROW(parser.Parse(SplitString("app --param1=x")), parse_exception);
+    ASSERT_THROW(parser.Parse(SplitString("app stray")), parse_exception);
+}
+
+TEST(ArgParserTestSuite, ArenaCapacityTest) {
+    ArgParser parser("My Parser", 300);
+    for (int i = 0; i < 100; i++) {
+        parser.AddIntArgument("int" + std::to_string(i)).Default(i);
+        parser.AddStringArgument("string" + std::to_string(i)).Default(std::to_string(i));
+        parser.AddFlag("flag" + std::to_string(i), "Flag number " + std::to_string(i));
+    }
+
+    ASSERT_TRUE(parser.Parse(SplitString("app --int42=1 --string7=x --flag99")));
+    ASSERT_EQ(parser.GetIntValue("int42"), 1);
+    ASSERT_EQ(parser.GetIntValue("int43"), 43);
+    ASSERT_EQ(parser.GetStringValue("string7"), "x");
+    ASSERT_TRUE(parser.GetFlag("flag99"));
+    ASSERT_FALSE(parser.GetFlag("flag98"));
+}
+
+TEST(ArgParserTestSuite, DuplicateKeyTest) {
+    ArgParser parser("My Parser");
+    parser.AddFlag('a', "flag1");
+    parser.AddIntArgument('a', "param1");
+
+    ASSERT_THROW(parser.Freeze(), settings_exception);
+}
+
+TEST(ArgParserTestSuite, ResetTest) {
+    ArgParser parser("My Parser");
+    std::vector<int> values;
+    bool flag;
+    parser.AddIntArgument("Param1").MultiValue(1).Positional().StoreValues(values);
+    parser.AddStringArgument('s', "str").Default("default");
+    parser.AddFlag('f', "flag").StoreValue(flag);
+    parser.AddFlag('g', "flag2").Default(true);
+    parser.AddHelp('h', "help", "Some Description about program");
+
+    ASSERT_TRUE(parser.Parse(SplitString("app 1 2 3 -f -s value -h")));
+    ASSERT_TRUE(parser.Help());
+    size_t capacity = values.capacity();
+
+    for (int i = 0; i < 3; i++) {
+        parser.Reset();
+        ASSERT_FALSE(flag);
+        ASSERT_TRUE(parser.GetFlag("flag2"));
+        ASSERT_FALSE(parser.Help());
+        ASSERT_EQ(values.capacity(), capacity);
+
+        ASSERT_TRUE(parser.Parse(SplitString("app 4 5")));
+        ASSERT_EQ(values, std::vector<int>({4, 5}));
+        ASSERT_EQ(parser.GetStringValue("str"), "default");
+        ASSERT_FALSE(flag);
+    }
+
+    parser.Reset();
+    ASSERT_FALSE(parser.Parse(SplitString("app -s value")));
+}
+
+TEST(ParseResultTestSuite, ValuesTest) {
+    ArgParser parser("My Parser");
+    std::vector<int> values;
+    parser.AddIntArgument("Param1").MultiValue(1).Positional().StoreValues(values);
+    parser.AddStringArgument('s', "str").Default("default");
+    parser.AddIntArgument('n', "number");
+    parser.AddFlag('f', "flag");
+    parser.AddFlag('g', "flag2").Default(true);
+    parser.AddHelp('h', "help", "Some Description about program");
+    parser.Freeze();
+
+    ParseResult result = parser.ParseToResult(SplitString("app 1 2 -n 5 3 -fh -n=6"));
+    ASSERT_TRUE(result.IsCorrect());
+    ASSERT_TRUE(result.Help());
+    ASSERT_EQ(result.GetIntValue("Param1", 2), 3);
+    ASSERT_EQ(result.GetIntValue("number"), 6);
+    ASSERT_EQ(result.GetStringValue("str"), "default");
+    ASSERT_TRUE(result.GetFlag("flag"));
+    ASSERT_TRUE(result.GetFlag("flag2"));
+    ASSERT_TRUE(values.empty());
+
+    ASSERT_FALSE(parser.ParseToResult(SplitString("app -s x")).IsCorrect());
+}
+
+TEST(ParseResultTestSuite, SparseEntriesTest) {
+    ArgParser parser("My Parser");
+    for (int i = 0; i < 1000; i++) {
+        parser.AddIntArgument("option-" + std::to_string(i)).Default(-1);
+    }
+    parser.AddIntArgument("N").MultiValue().Positional();
+    parser.Freeze();
+
+    ParseResult result = parser.ParseToResult(SplitString("app --option-7=7"));
+    ASSERT_TRUE(result.IsCorrect());
+    ASSERT_EQ(result.GetIntValue("option-7"), 7);
+    ASSERT_EQ(result.GetIntValue("option-8"), -1);
+    ASSERT_TRUE(result.GetIntValues("N").empty());
+    if constexpr (kInstrumentation) {
+        ASSERT_EQ(result.Stats().allocations, 2);
+    }
+
+    std::string command = "app 1 2";
+    for (int i = 0; i < 100; i += 2) {
+        command += " --option-" + std::to_string(i) + "=" + std::to_string(i);
+    }
+    result = parser.ParseToResult(SplitString(command + " 3"));
+    ASSERT_TRUE(result.IsCorrect());
+    for (int i = 0; i < 100; i++) {
+        ASSERT_EQ(result.GetIntValue("option-" + std::to_string(i)), i % 2 == 0 ? i : -1);
+    }
+    ASSERT_EQ(result.GetIntValues("N").size(), 3);
+}
+
+TEST(ParseResultTestSuite, RequiresFreezeTest) {
+    ArgParser parser("My Parser");
+    parser.AddFlag('f', "flag");
+
+    ASSERT_THROW((void) parser.ParseToResult(SplitString("app -f")), settings_exception);
+}
+
+namespace {
+    void BuildConcurrentSchema(ArgParser& parser) {
+        parser.AddIntArgument("N").MultiValue(1).Positional();
+        parser.AddStringArgument('o', "output");
+        parser.AddFlag('s', "sum");
+        parser.AddFlag('m', "mult");
+        parser.Freeze();
+    }
+
+    std::vector<std::string> MakeCommand(int thread, int iteration) {
+        std::vector<std::string> command = {"app", "--output=out" + std::to_string(thread)};
+        command.emplace_back(iteration % 2 ? "-s" : "-m");
+        for (int i = 0; i <= iteration % 16; i++) {
+            command.push_back(std::to_string(thread * 1000 + i));
+        }
+        return command;
+    }
+}
+
+TEST(ParseResultTestSuite, ConcurrentStressTest) {
+    ArgParser parser("My Parser");
+    BuildConcurrentSchema(parser);
+
+    constexpr int kThreads = 8;
+    constexpr int kIterations = 2000;
+    std::vector<int> failures(kThreads, 0);
+    std::vector<std::thread> workers;
+    for (int thread = 0; thread < kThreads; thread++) {
+        workers.emplace_back([&parser, &failures, thread] {
+            for (int iteration = 0; iteration < kIterations; iteration++) {
+                ParseResult result = parser.ParseToResult(MakeCommand(thread, iteration));
+                int last = iteration % 16;
+                bool ok = result.IsCorrect()
+                    && result.GetStringValue("output") == "out" + std::to_string(thread)
+                    && result.GetFlag("sum") == (iteration % 2 == 1)
+                    && result.GetFlag("mult") == (iteration % 2 == 0)
+                    && result.GetIntValue("N", last) == thread * 1000 + last;
+                failures[thread] += !ok;
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    ASSERT_EQ(failures, std::vector<int>(kThreads, 0));
+}
+
+TEST(ParseResultTestSuite, ConcurrentThroughputTest) {
+    ArgParser parser("My Parser");
+    BuildConcurrentSchema(parser);
+    std::vector<std::string> command = MakeCommand(1, 15);
+
+    constexpr int kIterations = 20000;
+    unsigned int max_threads = std::max(1u, std::min(8u, std::thread::hardware_concurrency()));
+    for (unsigned int threads = 1; threads <= max_threads; threads *= 2) {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<std::thread> workers;
+        for (unsigned int thread = 0; thread < threads; thread++) {
+            workers.emplace_back([&parser, &command] {
+                for (int iteration = 0; iteration < kIterations; iteration++) {
+                    ParseResult result = parser.ParseToResult(command);
+                    ASSERT_TRUE(result.IsCorrect());
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        double parses_per_second = threads * kIterations / elapsed.count();
+        RecordProperty("parses_per_second_" + std::to_string(threads), std::to_string(static_cast<int64_t>(parses_per_second)));
+        std::cout << "[ PERF     ] " << threads << " thread(s): " << static_cast<int64_t>(parses_per_second)
+                  << " parses/s" << std::endl;
+    }
+}
+
+TEST(ArgParserTestSuite, FeedTest) {
+    ArgParser parser("My Parser");
+    std::vector<int> values;
+    parser.AddIntArgument("Param1").MultiValue(2).Positional().StoreValues(values);
+    parser.AddStringArgument('s', "str");
+    parser.AddFlag('f', "flag");
+
+    for (std::string_view token : {"1", "-s", "value", "2", "-f", "3"}) {
+        parser.Feed(token);
+    }
+    ASSERT_TRUE(parser.Finish());
+    ASSERT_EQ(values, std::vector<int>({1, 2, 3}));
+    ASSERT_EQ(parser.GetStringValue("str"), "value");
+    ASSERT_TRUE(parser.GetFlag("flag"));
+
+    parser.Reset();
+    parser.Feed("1");
+    parser.Feed("--str");
+    ASSERT_THROW(parser.Finish(), parse_exception);
+}
+
+TEST(ArgParserTestSuite, IstreamTest) {
+    ArgParser parser("My Parser");
+    std::vector<int> values;
+    parser.AddIntArgument("Param1").MultiValue(1).Positional().StoreValues(values);
+    parser.AddFlag("sum", "add args");
+
+    std::stringstream input;
+    input << "--sum\n";
+    for (int i = 0; i < 100000; i++) {
+        input << i << (i % 10 == 9 ? '\n' : ' ');
+    }
+
+    ASSERT_TRUE(parser.Parse(input));
+    ASSERT_TRUE(parser.GetFlag("sum"));
+    ASSERT_EQ(values.size(), 100000);
+    ASSERT_EQ(values[99999], 99999);
+}
+
+TEST(ArgParserTestSuite, StatsTest) {
+    ArgParser parser("My Parser");
+    parser.AddIntArgument('p', "param");
+    parser.AddStringArgument("name").Default("none");
+    parser.AddIntArgument("N").MultiValue().Positional();
+    parser.AddFlag('a', "first");
+    parser.AddFlag('b', "second");
+    uint64_t reports = 0;
+    parser.SetStatsCallback([&reports](const ParseStats&) { reports++; });
+
+    ASSERT_TRUE(parser.Parse(SplitString("app 1 2 -ab --param=3 --name x -p 4")));
+    ASSERT_THROW(parser.Parse(SplitString("app --unknown")), parse_exception);
+
+    const ParseStats& stats = parser.Stats();
+    if constexpr (kInstrumentation) {
+        ASSERT_EQ(reports, 2);
+        ASSERT_EQ(stats.long_tokens, 1);
+        ASSERT_EQ(stats.lookup_misses, 1);
+        ASSERT_EQ(stats.exceptions, 1);
+
+        parser.Reset();
+        ASSERT_TRUE(parser.Parse(SplitString("app 1 2 -ab --param=3 --name x -p 4")));
+        ASSERT_EQ(stats.positional_tokens, 2);
+        ASSERT_EQ(stats.short_tokens, 2);
+        ASSERT_EQ(stats.long_tokens, 1);
+        ASSERT_EQ(stats.equals_tokens, 1);
+        ASSERT_EQ(stats.value_tokens, 2);
+        ASSERT_EQ(stats.lookups, 5);
+        ASSERT_EQ(stats.lookup_misses, 0);
+        ASSERT_EQ(stats.exceptions, 0);
+        ASSERT_GT(stats.schema_build.count(), 0);
+    } else {
+        ASSERT_EQ(reports, 0);
+        ASSERT_EQ(stats.lookups, 0);
+        ASSERT_EQ(stats.tokenize.count(), 0);
+    }
+}
+
+TEST(ArgParserTestSuite, HelpDescriptionTest) {
+    ArgParser parser("My Parser");
+    parser.AddHelp('h', "help", "Some Description about program");
+    parser.AddStringArgument('i', "input", "File path for input file").MultiValue(1);
+    parser.AddFlag('s', "flag1", "Use some logic").Default(true);
+    parser.AddFlag('p', "flag2", "Use some logic");
+    parser.AddIntArgument("number", "Some Number").Default(5);
+
+    std::string_view help = parser.HelpDescription();
+    ASSERT_EQ(
+        help,
+        "My Parser\n"
+        "Some Description about program\n"
+        "\n"
+        "-i, --input=<string>  File path for input file [repeated, min args = 1]\n"
+        "-s, --flag1           Use some logic [default = true]\n"
+        "-p, --flag2           Use some logic\n"
+        "    --number=<int>    Some Number [default = 5]\n"
+        "\n"
+        "-h, --help            Display this help and exit\n"
+    );
+    ASSERT_EQ(parser.HelpDescription().data(), help.data());
+
+    parser.AddFlag('v', "verbose-output", "More logs");
+    ASSERT_NE(parser.HelpDescription().find("-v, --verbose-output  More logs\n"), std::string_view::npos);
+    ASSERT_NE(parser.HelpDescription().find("-h, --help            Display"), std::string_view::npos);
+}
+
+TEST(ArgParserTestSuite, HelpInvalidationTest) {
+    ArgParser parser("My Parser");
+    parser.AddHelp('h', "help", "Some Description about program");
+    Argument<int>& number = parser.AddIntArgument("number", "Some Number");
+    Argument<std::string>& input = parser.AddStringArgument('i', "input", "Input files");
+    Flag& flag = parser.AddFlag('f', "flag", "Use some logic");
+
+    ASSERT_EQ(parser.HelpDescription().find("[default"), std::string_view::npos);
+    number.Default(5);
+    ASSERT_NE(parser.HelpDescription().find("Some Number [default = 5]\n"), std::string_view::npos);
+    flag.Default(true);
+    ASSERT_NE(parser.HelpDescription().find("Use some logic [default = true]\n"), std::string_view::npos);
+    input.MultiValue(1).Positional();
+    ASSERT_NE(parser.HelpDescription().find("Input files [positional] [repeated, min args = 1]\n"),
+              std::string_view::npos);
+
+    ASSERT_TRUE(parser.Parse(SplitString("app a b")));
+    ASSERT_EQ(parser.GetStringValue("input", 1), "b");
+}
+
+TEST(ArgParserTestSuite, HandleTest) {
+    ArgParser parser("My Parser");
+    IntHandle param = parser.AddIntArgument('p', "param").Default(7).Handle();
+    StringHandle name = parser.AddStringArgument("name").Handle();
+    IntHandle values = parser.AddIntArgument("N").MultiValue(1).Positional().Handle();
+    FlagHandle flag = parser.AddFlag('f', "flag").Handle();
+
+    ASSERT_TRUE(parser.Parse(SplitString("app --name=abc 1 2 3 -f")));
+    ASSERT_EQ(parser.Get(param), 7);
+    ASSERT_EQ(parser.Get(name), "abc");
+    ASSERT_EQ(parser.Get(values, 2), 3);
+    ASSERT_TRUE(parser.Get(flag));
+
+    ParseResult result = parser.ParseToResult(SplitString("app -p 5 --name=xyz 4"));
+    ASSERT_EQ(result.Get(param), 5);
+    ASSERT_EQ(result.Get(name), "xyz");
+    ASSERT_EQ(result.Get(values, 0), 4);
+    ASSERT_FALSE(result.Get(flag));
+}
+
+TEST(ArgParserTestSuite, BulkValuesTest) {
+    ArgParser parser("My Parser");
+    parser.AddIntArgument("N").MultiValue(1).Positional();
+    parser.AddIntArgument("defaults").MultiValue(1).Default(std::vector<int>{4, 5});
+    parser.AddIntArgument("single").Default(9);
+    parser.AddStringArgument('s', "str").MultiValue();
+
+    ASSERT_TRUE(parser.Parse(SplitString("app 1 2 3 -s a --str=bc")));
+    ASSERT_EQ(std::vector<int>(parser.GetIntValues("N").begin(), parser.GetIntValues("N").end()),
+              std::vector<int>({1, 2, 3}));
+    ASSERT_EQ(std::vector<int>(parser.GetIntValues("defaults").begin(), parser.GetIntValues("defaults").end()),
+              std::vector<int>({4, 5}));
+    ASSERT_EQ(parser.GetIntValues("single").size(), 1);
+    ASSERT_EQ(parser.GetIntValues("single")[0], 9);
+    ASSERT_EQ(parser.GetStringValues("str").size(), 2);
+    ASSERT_EQ(parser.GetStringView("str", 1), "bc");
+
+    ParseResult result = parser.ParseToResult(SplitString("app 7 -s x"));
+    ASSERT_EQ(result.GetIntValues("N").size(), 1);
+    ASSERT_EQ(result.GetIntValues("N")[0], 7);
+    ASSERT_EQ(result.GetIntValues("defaults").size(), 2);
+    ASSERT_EQ(result.GetStringView("str"), "x");
+    ASSERT_EQ(result.GetStringValues("str").size(), 1);
+}
+
+TEST(ArgParserTestSuite, OptionalMultiValueDefaultsTest) {
+    ArgParser parser("My Parser");
+    parser.AddIntArgument("numbers").MultiValue().Default(std::vector<int>{1, 2});
+    parser.AddStringArgument('w', "words").MultiValue().Default(std::vector<std::string>{"a", "b"});
+    parser.AddStringArgument('e', "empty").MultiValue();
+
+    ASSERT_TRUE(parser.Parse(SplitString("app")));
+    ASSERT_EQ(std::vector<int>(parser.GetIntValues("numbers").begin(), parser.GetIntValues("numbers").end()),
+              std::vector<int>({1, 2}));
+    ASSERT_EQ(parser.GetIntValue("numbers", 1), 2);
+    ASSERT_EQ(parser.GetStringValues("words").size(), 2);
+    ASSERT_EQ(parser.GetStringView("words", 1), "b");
+    ASSERT_TRUE(parser.GetStringValues("empty").empty());
+
+    ParseResult result = parser.ParseToResult(SplitString("app"));
+    ASSERT_EQ(std::vector<int>(result.GetIntValues("numbers").begin(), result.GetIntValues("numbers").end()),
+              std::vector<int>({1, 2}));
+    ASSERT_EQ(result.GetIntValue("numbers", 1), 2);
+    ASSERT_EQ(result.GetStringValues("words").size(), 2);
+    ASSERT_EQ(result.GetStringValue("words"), "a");
+    ASSERT_TRUE(result.GetStringValues("empty").empty());
+
+    parser.Reset();
+    ASSERT_TRUE(parser.Parse(SplitString("app --numbers=7 -w c")));
+    ASSERT_EQ(parser.GetIntValues("numbers").size(), 1);
+    ASSERT_EQ(parser.GetIntValue("numbers"), 7);
+    ASSERT_EQ(parser.GetStringValues("words").size(), 1);
+
+    result = parser.ParseToResult(SplitString("app --numbers=7 -w c"));
+    ASSERT_EQ(result.GetIntValues("numbers").size(), 1);
+    ASSERT_EQ(result.GetStringValue("words"), "c");
+}
+
+enum class Mode {
+    kFast, kSafe
+};
+
+template<>
+struct ArgumentParser::EnumNames<Mode> {
+    static constexpr std::pair<std::string_view, Mode> kNames[] = {{"fast", Mode::kFast}, {"safe", Mode::kSafe}};
+};
+
+struct Point {
+    int x = 0;
+    int y = 0;
+};
+
+template<>
+struct ArgumentParser::ValueConverter<Point> {
+    static bool Parse(std::string_view token, Point& value) {
+        size_t comma = token.find(',');
+        return comma != std::string_view::npos
+            && ValueConverter<int>::Parse(token.substr(0, comma), value.x)
+            && ValueConverter<int>::Parse(token.substr(comma + 1), value.y);
+    }
+};
+
+TEST(ArgParserTestSuite, GenericArgumentTest) {
+    ArgParser parser("My Parser");
+    uint64_t size = 0;
+    parser.AddArgument<uint64_t>('s', "size").StoreValue(size);
+    parser.AddArgument<double>("ratio").Default(0.5);
+    parser.AddArgument<Mode>("mode", "Execution mode");
+    auto point = parser.AddArgument<Point>("point").Handle();
+    parser.AddArgument<int64_t>("offsets").MultiValue(1).Positional();
+    parser.AddArgument<int>("count");
+
+    ASSERT_TRUE(parser.Parse(SplitString(
+        "app -s 10000000000 --mode=safe --point 3,4 5 6 --count=2"
+    )));
+    ASSERT_EQ(size, 10000000000ULL);
+    ASSERT_EQ(parser.GetValue<double>("ratio"), 0.5);
+    ASSERT_EQ(parser.GetValue<Mode>("mode"), Mode::kSafe);
+    ASSERT_EQ(parser.Get(point).y, 4);
+    ASSERT_EQ(parser.GetValues<int64_t>("offsets").size(), 2);
+    ASSERT_EQ(parser.GetValue<int64_t>("offsets", 1), 6);
+    ASSERT_EQ(parser.GetIntValue("count"), 2);
+    ASSERT_THROW((void) parser.GetValue<float>("ratio"), parse_exception);
+
+    ParseResult result = parser.ParseToResult(SplitString("app -s 1 --ratio=2.25 --mode fast --point=0,1 7 --count=1"));
+    ASSERT_TRUE(result.IsCorrect());
+    ASSERT_EQ(result.GetValue<uint64_t>("size"), 1);
+    ASSERT_EQ(result.GetValue<double>("ratio"), 2.25);
+    ASSERT_EQ(result.GetValue<Mode>("mode"), Mode::kFast);
+    ASSERT_EQ(result.Get(point).x, 0);
+
+    parser.Reset();
+    ASSERT_THROW(parser.Parse(SplitString("app --mode=slow")), parse_exception);
+    ASSERT_THROW(parser.Parse(SplitString("app --ratio=1.5x")), parse_exception);
+    ASSERT_THROW(parser.Parse(SplitString("app -s -1")), parse_exception);
+}
+
+TEST(ArgParserTestSuite, ShortClusterTest) {
+    ArgParser parser("My Parser");
+    parser.AddFlag('a', "first");
+    parser.AddFlag('b', "second");
+    parser.AddIntArgument('n', "number").Default(0);
+    parser.AddHelp('h', "help", "Cluster test");
+
+    ASSERT_TRUE(parser.Parse(SplitString("app -ab -n 3")));
+    ASSERT_TRUE(parser.GetFlag("first"));
+    ASSERT_TRUE(parser.GetFlag("second"));
+    ASSERT_EQ(parser.GetIntValue("number"), 3);
+
+    parser.Reset();
+    ASSERT_TRUE(parser.Parse(SplitString("app -bah")));
+    ASSERT_TRUE(parser.Help());
+
+    parser.Reset();
+    ASSERT_THROW(parser.Parse(SplitString("app -abz")), parse_exception);
+    ASSERT_THROW(parser.Parse(SplitString("app -an")), parse_exception);
+    ASSERT_THROW(parser.Parse(std::vector<std::string>{"app", "-a\xff"}), parse_exception);
+}
+
+TEST(ArgParserTestSuite, SubcommandTest) {
+    ArgParser parser("tool");
+    parser.AddFlag('v', "verbose");
+    parser.AddHelp('h', "help", "Tool with subcommands");
+    int built = 0;
+    parser.AddSubcommand("build", [&built](ArgParser& build) {
+        built++;
+        build.AddIntArgument('j', "jobs").Default(1);
+        build.AddStringArgument("target").MultiValue(1).Positional();
+        build.AddHelp('h', "help", "Build targets");
+    }, "Build targets");
+    parser.AddSubcommand("clean", [](ArgParser&) {
+        FAIL() << "clean isn't selected";
+    }, "Remove outputs");
+
+    ASSERT_NE(parser.HelpDescription().find("Subcommands:\nbuild"), std::string_view::npos);
+    ASSERT_EQ(parser.Subcommand(), nullptr);
+
+    ASSERT_TRUE(parser.Parse(SplitString("tool -v build -j 4 lib bin")));
+    ASSERT_EQ(built, 1);
+    ASSERT_EQ(parser.SubcommandName(), "build");
+    ASSERT_TRUE(parser.GetFlag("verbose"));
+    ArgParser* build = parser.Subcommand();
+    ASSERT_NE(build, nullptr);
+    ASSERT_EQ(build->GetIntValue("jobs"), 4);
+    ASSERT_EQ(build->GetStringValue("target", 1), "bin");
+
+    parser.Reset();
+    ASSERT_FALSE(parser.Parse(SplitString("tool build -j 2")));
+    ASSERT_EQ(built, 1);
+
+    parser.Reset();
+    ASSERT_FALSE(parser.Parse(SplitString("tool build --help")));
+    ASSERT_FALSE(parser.Help());
+    ASSERT_TRUE(parser.Subcommand()->Help());
+
+    parser.Reset();
+    parser.Feed("build");
+    parser.Feed("all");
+    ASSERT_TRUE(parser.Finish());
+    ASSERT_EQ(parser.Subcommand()->GetStringValue("target"), "all");
+
+    parser.Freeze();
+    ASSERT_THROW((void) parser.ParseToResult(SplitString("tool build x")), settings_exception);
+}
+
+TEST(ArgParserTestSuite, SubcommandAfterPositionalsTest) {
+    ArgParser parser("tool");
+    parser.AddIntArgument("N").MultiValue(1).Positional();
+    parser.AddSubcommand("go", [](ArgParser& go) {
+        go.AddFlag('f', "fast");
+    });
+    std::vector<std::string> argv = SplitString("tool 1 2 go -f");
+
+    ASSERT_TRUE(parser.Parse(argv));
+    ASSERT_EQ(parser.GetIntValues("N").size(), 2);
+    ASSERT_EQ(parser.SubcommandName(), "go");
+    ASSERT_TRUE(parser.Subcommand()->GetFlag("fast"));
+
+    parser.Reset();
+    for (size_t i = 1; i < argv.size(); i++) {
+        parser.Feed(argv[i]);
+    }
+    ASSERT_TRUE(parser.Finish());
+    ASSERT_EQ(parser.GetIntValues("N").size(), 2);
+    ASSERT_EQ(parser.SubcommandName(), "go");
+    ASSERT_TRUE(parser.Subcommand()->GetFlag("fast"));
+}
+
+TEST(ArgParserTestSuite, FallbackSourcesTest) {
+    std::string path = testing::TempDir() + "argparser_fallback.conf";
+    {
+        std::ofstream config(path);
+        config << "# deployment defaults\n"
+                  "threads = 8\n"
+                  "name \"from file\"\n"
+                  "\n"
+                  "level=1\n"
+                  "input = a.txt\n"
+                  "input = b.txt\n"
+                  "unknown-key = whatever\n"
+                  "verbose\n";
+    }
+    setenv("ARGTEST_LEVEL", "2", 1);
+    setenv("ARGTEST_MAX_SIZE", "30 40", 1);
+
+    ArgParser parser("My Parser");
+    parser.AddIntArgument("threads").Default(1);
+    parser.AddIntArgument("level").Default(0);
+    parser.AddStringArgument('n', "name");
+    parser.AddStringArgument('i', "input").MultiValue();
+    parser.AddIntArgument("max-size").MultiValue();
+    parser.AddFlag('v', "verbose");
+    parser.SetEnvPrefix("ARGTEST_");
+    parser.SetConfigFile(path);
+
+    ASSERT_TRUE(parser.Parse(SplitString("app --name=argv")));
+    ASSERT_EQ(parser.GetStringValue("name"), "argv");
+    ASSERT_EQ(parser.GetIntValue("level"), 2);
+    ASSERT_EQ(parser.GetIntValue("threads"), 8);
+    ASSERT_EQ(parser.GetIntValues("max-size").size(), 2);
+    ASSERT_EQ(parser.GetIntValue("max-size", 1), 40);
+    ASSERT_EQ(parser.GetStringValues("input").size(), 2);
+    ASSERT_TRUE(parser.GetFlag("verbose"));
+
+    parser.Reset();
+    ASSERT_TRUE(parser.Parse(SplitString("app -i c.txt")));
+    ASSERT_EQ(parser.GetStringValue("name"), "from file");
+    ASSERT_EQ(parser.GetStringValues("input").size(), 1);
+
+    ParseResult result = parser.ParseToResult(SplitString("app --threads=3"));
+    ASSERT_EQ(result.GetIntValue("threads"), 3);
+    ASSERT_EQ(result.GetIntValue("level"), 2);
+    ASSERT_EQ(result.GetStringValue("name"), "from file");
+
+    setenv("ARGTEST_LEVEL", "high", 1);
+    parser.Reset();
+    ASSERT_THROW(parser.Parse(SplitString("app")), parse_exception);
+    unsetenv("ARGTEST_LEVEL");
+    unsetenv("ARGTEST_MAX_SIZE");
+    std::remove(path.c_str());
+
+    ASSERT_THROW(parser.SetConfigFile(path), settings_exception);
+}
+
+TEST(ArgParserTestSuite, FallbackFlagOffTest) {
+    setenv("FLAGTEST_VERBOSE", "off", 1);
+    ArgParser parser("My Parser");
+    bool verbose = false;
+    parser.AddFlag('v', "verbose").Default(true).StoreValue(verbose);
+    parser.SetEnvPrefix("FLAGTEST_");
+    parser.Freeze();
+
+    ASSERT_TRUE(parser.Parse(SplitString("app")));
+    ASSERT_FALSE(parser.GetFlag("verbose"));
+    ASSERT_FALSE(verbose);
+    ASSERT_FALSE(parser.ParseToResult(SplitString("app")).GetFlag("verbose"));
+
+    parser.Reset();
+    ASSERT_TRUE(parser.Parse(SplitString("app -v")));
+    ASSERT_TRUE(verbose);
+    ASSERT_TRUE(parser.ParseToResult(SplitString("app --verbose")).GetFlag("verbose"));
+
+    setenv("FLAGTEST_VERBOSE", "maybe", 1);
+    parser.Reset();
+    ASSERT_THROW(parser.Parse(SplitString("app")), parse_exception);
+    unsetenv("FLAGTEST_VERBOSE");
+}
+
+TEST(ArgParserTestSuite, TryParseTest) {
+    ArgParser parser("My Parser");
+    parser.AddIntArgument('p', "param").MultiValue(2);
+    parser.AddStringArgument('n', "name");
+    parser.AddFlag('a', "all");
+    parser.AddFlag('b', "brief");
+
+    auto error = parser.TryParse(SplitString("app --param=1 --unknown"));
+    ASSERT_FALSE(error.has_value());
+    ASSERT_EQ(error.error().code, ParseErrorCode::kUnknownKey);
+    ASSERT_EQ(error.error().token_index, 2);
+    ASSERT_EQ(error.error().key, "unknown");
+
+    parser.Reset();
+    error = parser.TryParse(SplitString("app -p 1 -p 2x"));
+    ASSERT_EQ(error.error().code, ParseErrorCode::kNotAnInteger);
+    ASSERT_EQ(error.error().token_index, 4);
+    ASSERT_EQ(error.error().value, "2x");
+    ASSERT_NE(error.error().Message().find("token 4"), std::string::npos);
+
+    parser.Reset();
+    error = parser.TryParse(SplitString("app -abn"));
+    ASSERT_EQ(error.error().code, ParseErrorCode::kNotAFlag);
+    ASSERT_EQ(error.error().key, "n");
+
+    parser.Reset();
+    error = parser.TryParse(SplitString("app --name"));
+    ASSERT_EQ(error.error().code, ParseErrorCode::kMissingValue);
+
+    parser.Reset();
+    error = parser.TryParse(SplitString("app -p 1 --name=x"));
+    ASSERT_EQ(error.error().code, ParseErrorCode::kRequirementsNotMet);
+    ASSERT_EQ(error.error().key, "param");
+
+    parser.Reset();
+    ASSERT_TRUE(parser.TryParse(SplitString("app -p 1 -p 2 --name=x -ab")).has_value());
+    ASSERT_EQ(parser.GetIntValue("param", 1), 2);
+    ASSERT_TRUE(parser.GetFlag("brief"));
+}
+
+TEST(ArgParserTestSuite, EmptyInputFallbackTest) {
+    setenv("EMPTYTEST_LEVEL", "3", 1);
+    ArgParser parser("My Parser");
+    parser.AddIntArgument("level");
+    parser.SetEnvPrefix("EMPTYTEST_");
+
+    ASSERT_TRUE(parser.Parse(std::vector<std::string>()));
+    ASSERT_EQ(parser.GetIntValue("level"), 3);
+    parser.Reset();
+    ASSERT_TRUE(parser.TryParse(std::vector<std::string>()).has_value());
+    ASSERT_EQ(parser.GetIntValue("level"), 3);
+    parser.Reset();
+    ASSERT_TRUE(parser.Parse(0, nullptr));
+    ASSERT_EQ(parser.GetIntValue("level"), 3);
+    unsetenv("EMPTYTEST_LEVEL");
+}
+
+TEST(ArgParserTestSuite, CompactStorageTest) {
+    ASSERT_LE(sizeof(Argument<int>), sizeof(ArgumentBase) + 48);
+    ASSERT_LE(sizeof(Argument<std::string>), sizeof(ArgumentBase) + sizeof(std::string) + 24);
+
+    struct CountingResource : std::pmr::memory_resource {
+        size_t allocations = 0;
+        size_t bytes = 0;
+
+        void* do_allocate(size_t size, size_t alignment) override {
+            allocations++;
+            bytes += size;
+            return std::pmr::new_delete_resource()->allocate(size, alignment);
+        }
+
+        void do_deallocate(void* pointer, size_t size, size_t alignment) override {
+            std::pmr::new_delete_resource()->deallocate(pointer, size, alignment);
+        }
+
+        [[nodiscard]] bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+            return this == &other;
+        }
+    } resource;
+
+    constexpr size_t kOptions = 1000;
+    std::pmr::memory_resource* previous = std::pmr::set_default_resource(&resource);
+    {
+        ArgParser parser("My Parser", kOptions);
+        size_t allocations = global_allocations;
+        for (size_t i = 0; i < kOptions; i++) {
+            if (i % 2 == 0) {
+                parser.AddStringArgument("option-" + std::to_string(i)).Default("value");
+            } else {
+                parser.AddIntArgument("option-" + std::to_string(i)).Default(static_cast<int>(i));
+            }
+        }
+        allocations = global_allocations - allocations;
+        std::pmr::set_default_resource(previous);
+
+        ASSERT_EQ(allocations, 0);
+        ASSERT_EQ(resource.allocations, 1);
+        ASSERT_LE(resource.bytes, kOptions * 400);
+        ASSERT_TRUE(parser.Parse(SplitString("app --option-7=70 --option-8=x")));
+        ASSERT_EQ(parser.GetIntValue("option-7"), 70);
+        ASSERT_EQ(parser.GetIntValue("option-9"), 9);
+        ASSERT_EQ(parser.GetStringValue("option-8"), "x");
+        ASSERT_EQ(parser.GetStringValue("option-10"), "value");
+    }
+}
+
+TEST(ArgParserTestSuite, StoreToTest) {
+    ArgParser parser("My Parser");
+    int64_t sum = 0;
+    std::vector<std::string> names;
+    parser.AddIntArgument("N").MultiValue(3).Positional().StoreTo([&sum](const int& value) {
+        sum += value;
+    });
+    parser.AddStringArgument('n', "name").MultiValue().StoreTo([&names](const std::string& value) {
+        names.push_back(value);
+    });
+
+    ASSERT_TRUE(parser.Parse(SplitString("app 1 2 3 4 -n a --name=b")));
+    ASSERT_EQ(sum, 10);
+    ASSERT_EQ(names, std::vector<std::string>({"a", "b"}));
+    ASSERT_TRUE(parser.GetIntValues("N").empty());
+
+    parser.Reset();
+    sum = 0;
+    ASSERT_FALSE(parser.Parse(SplitString("app 5 6")));
+    ASSERT_EQ(sum, 11);
+
+    ASSERT_THROW(parser.AddIntArgument("single").StoreTo([](const int&) {}), settings_exception);
+}
+
+TEST(ArgParserTestSuite, LazyConversionTest) {
+    ArgParser parser("My Parser");
+    parser.SetLazyConversion(true);
+    parser.AddIntArgument('p', "param").MultiValue(2);
+    parser.AddIntArgument("bad");
+    parser.AddStringArgument('n', "name").Default("none");
+    int stored = 0;
+    parser.AddIntArgument("stored").StoreValue(stored);
+    IntHandle param = parser.AddIntArgument("positional").MultiValue().Positional().Handle();
+
+    std::vector<std::string> argv = SplitString("app -p 1 --param=2 --bad=x --name=lazy --stored=7 3 4 5");
+    ASSERT_TRUE(parser.Parse(argv));
+    ASSERT_EQ(stored, 7);
+    ASSERT_EQ(parser.Get(param, 2), 5);
+    ASSERT_EQ(parser.GetIntValues("param").size(), 2);
+    ASSERT_EQ(parser.GetIntValue("param", 1), 2);
+    ASSERT_EQ(parser.GetStringValue("name"), "lazy");
+    ASSERT_THROW(parser.GetIntValue("bad"), parse_exception);
+    ASSERT_THROW(parser.GetIntValue("bad"), parse_exception);
+
+    parser.Reset();
+    argv = SplitString("app -p 1 --bad=1 --stored=1");
+    ASSERT_FALSE(parser.Parse(argv));
+    argv = SplitString("app -p 1 -p 2 --bad=1 --stored=1");
+    parser.Reset();
+    ASSERT_TRUE(parser.Parse(argv));
+    ASSERT_EQ(parser.GetStringValue("name"), "none");
+    ASSERT_TRUE(parser.GetIntValues("positional").empty());
+}
+
+TEST(ArgParserTestSuite, LazyTemporaryTokensTest) {
+    ArgParser parser("My Parser");
+    parser.SetLazyConversion(true);
+    parser.AddStringArgument('n', "name");
+    parser.AddStringArgument("path").MultiValue(1).Positional();
+    parser.AddIntArgument('p', "param");
+
+    ASSERT_TRUE(parser.Parse(SplitString("app --name=first-long-enough-to-allocate -p 42 a/very/long/path/to/allocate")));
+    std::vector<std::string> other = SplitString("app --name=something-else-long-enough-to-allocate -p 7 b");
+    ASSERT_EQ(parser.GetStringValue("name"), "first-long-enough-to-allocate");
+    ASSERT_EQ(parser.GetIntValue("param"), 42);
+    ASSERT_EQ(parser.GetStringValue("path"), "a/very/long/path/to/allocate");
+
+    parser.Reset();
+    ASSERT_TRUE(parser.TryParse(SplitString("app -n second-long-enough-to-allocate -p 13 c")).has_value());
+    other = SplitString("app --name=something-else-long-enough-to-allocate -p 7 b");
+    ASSERT_EQ(parser.GetStringValue("name"), "second-long-enough-to-allocate");
+    ASSERT_EQ(parser.GetIntValue("param"), 13);
+    ASSERT_EQ(parser.GetStringValue("path"), "c");
+}
+
+TEST(ArgParserTestSuite, LazyStreamTest) {
+    ArgParser parser("My Parser");
+    parser.SetLazyConversion(true);
+    parser.AddStringArgument('n', "name");
+    parser.AddStringArgument("path").MultiValue(1).Positional();
+    parser.AddIntArgument('p', "param");
+
+    std::stringstream input("--name=first-long-enough-to-allocate -p 42 a/very/long/path/to/allocate b");
+    ASSERT_TRUE(parser.Parse(input));
+    ASSERT_EQ(parser.GetStringValue("name"), "first-long-enough-to-allocate");
+    ASSERT_EQ(parser.GetIntValue("param"), 42);
+    ASSERT_EQ(parser.GetStringValue("path"), "a/very/long/path/to/allocate");
+    ASSERT_EQ(parser.GetStringValue("path", 1), "b");
+
+    parser.Reset();
+    for (int i = 0; i < 3; i++) {
+        parser.Feed(std::string("--param=") + std::to_string(i + 10));
+    }
+    parser.Feed(std::string("c"));
+    parser.Feed(std::string("-n"));
+    parser.Feed(std::string("second-long-enough-to-allocate"));
+    ASSERT_TRUE(parser.Finish());
+    ASSERT_EQ(parser.GetStringValue("name"), "second-long-enough-to-allocate");
+    ASSERT_EQ(parser.GetIntValue("param"), 12);
+    ASSERT_EQ(parser.GetStringValue("path"), "c");
+}
+
+TEST(ArgParserTestSuite, CompletionTest) {
+    ArgParser parser("My Parser");
+    parser.AddStringArgument('i', "input", "Input files").MultiValue();
+    parser.AddIntArgument("threads", "Worker threads");
+    parser.AddFlag('v', "verbose", "More logs");
+    parser.AddHelp('h', "help", "Completion test");
+    bool built = false;
+    parser.AddSubcommand("build", [&built](ArgParser& build) {
+        built = true;
+        build.AddFlag('r', "release", "Optimized build");
+    }, "Build the project");
+
+    std::string bash = parser.GenerateCompletion("bash", "tool");
+    ASSERT_TRUE(built);
+    ASSERT_NE(bash.find("complete -F _tool_complete tool\n"), std::string::npos);
+    ASSERT_NE(bash.find("-i|--input) compopt -o filenames;"), std::string::npos);
+    ASSERT_NE(bash.find("--threads) return ;;"), std::string::npos);
+    ASSERT_NE(bash.find("build) _tool_build $((i + 1)); return ;;"), std::string::npos);
+    ASSERT_NE(bash.find("compgen -W \"--release\" -- \"$cur\""), std::string::npos);
+    ASSERT_NE(bash.find("#   -h|--help  Display this help and exit\n"), std::string::npos);
+
+    std::string zsh = parser.GenerateCompletion("zsh", "tool");
+    ASSERT_TRUE(zsh.starts_with("#compdef tool\n"));
+    ASSERT_NE(zsh.find("'*'{-i,--input=}'[Input files]:string:_files'"), std::string::npos);
+    ASSERT_NE(zsh.find("'(-v --verbose)'{-v,--verbose}'[More logs]'"), std::string::npos);
+    ASSERT_NE(zsh.find("build\\:\"Build the project\""), std::string::npos);
+    ASSERT_NE(zsh.find("{-h,--help}'[Display this help and exit]'"), std::string::npos);
+    ASSERT_NE(zsh.find("_tool_build() {"), std::string::npos);
+    ASSERT_EQ(parser.SubcommandName(), "");
+
+    ASSERT_THROW(parser.GenerateCompletion("fish", "tool"), settings_exception);
+    // A display name with a space would register two wrong commands.
+    ASSERT_THROW(parser.GenerateCompletion("bash"), settings_exception);
+    ASSERT_THROW(parser.GenerateCompletion("zsh", "my tool"), settings_exception);
+    ASSERT_THROW(parser.GenerateCompletion("zsh", "tool;rm"), settings_exception);
+
+    ArgParser named("my-tool");
+    named.AddFlag('v', "verbose", "More logs");
+    ASSERT_NE(named.GenerateCompletion("bash").find("complete -F _my_tool_complete my-tool\n"), std::string::npos);
+    ASSERT_TRUE(named.GenerateCompletion("zsh").starts_with("#compdef my-tool\n"));
+}
+
+TEST(ArgParserTestSuite, PrefixResolutionTest) {
+    ArgParser parser("My Parser");
+    parser.AddIntArgument("mult").Default(0);
+    parser.AddIntArgument("mode").Default(0);
+    parser.AddFlag('v', "verbose");
+    parser.AddFlag("version", "Print the version");
+    for (int i = 0; i < 5000; i++) {
+        parser.AddFlag("option-" + std::to_string(i), "");
+    }
+
+    ASSERT_TRUE(parser.Parse(SplitString("app --mu 3 --mod=4 --verb")));
+    ASSERT_EQ(parser.GetIntValue("mult"), 3);
+    ASSERT_EQ(parser.GetIntValue("mode"), 4);
+    ASSERT_TRUE(parser.GetFlag("verbose"));
+    ASSERT_FALSE(parser.GetFlag("version"));
+
+    parser.Reset();
+    auto error = parser.TryParse(SplitString("app --m 3"));
+    ASSERT_EQ(error.error().code, ParseErrorCode::kAmbiguousKey);
+    ASSERT_EQ(error.error().value, "mode, mult");
+    ASSERT_THROW(parser.Parse(SplitString("app --ver")), parse_exception);
+
+    parser.Reset();
+    error = parser.TryParse(SplitString("app --verbsoe"));
+    ASSERT_EQ(error.error().code, ParseErrorCode::kUnknownKey);
+    ASSERT_EQ(error.error().suggestion, "verbose");
+    ASSERT_NE(error.error().Message().find("did you mean [verbose]?"), std::string::npos);
+
+    parser.Reset();
+    error = parser.TryParse(SplitString("app --option-49999"));
+    ASSERT_EQ(error.error().suggestion, "option-4999");
+
+    parser.Reset();
+    error = parser.TryParse(SplitString("app --unrelated"));
+    ASSERT_EQ(error.error().code, ParseErrorCode::kUnknownKey);
+    ASSERT_TRUE(error.error().suggestion.empty());
+}
@@ -0,0 +1,185 @@
+#include <bin/Reduction.h>
+#include <gtest/gtest.h>
+#include <climits>
+#include <limits>
+#include <stdexcept>
+
+using namespace Reduction;
+
+// Values spread over a few parallel chunks, with a tail the vector
+// kernels handle one by one.
+std::vector<int> LongInput() {
+    std::vector<int> values(4 * kParallelThreshold + 5);
+    for (size_t i = 0; i < values.size(); i++) {
+        values[i] = static_cast<int>(i % 1000) - 500;
+    }
+    values[1] = INT_MAX;
+    values[values.size() / 2] = INT_MAX;
+    values.back() = INT_MAX;
+    return values;
+}
+
+int64_t PlainSum(const std::vector<int>& values) {
+    int64_t sum = 0;
+    for (int value : values) {
+        sum += value;
+    }
+    return sum;
+}
+
+TEST(ReductionTestSuite, SumPastIntTest) {
+    std::vector<int> values(3, INT_MAX);
+    Result result = Sum(values);
+    ASSERT_FALSE(result.overflow);
+    ASSERT_EQ(result.value, int64_t{3} * INT_MAX);
+
+    values.assign(19, INT_MIN);
+    result = Sum(values);
+    ASSERT_FALSE(result.overflow);
+    ASSERT_EQ(result.value, int64_t{19} * INT_MIN);
+
+    ASSERT_EQ(Sum({}).value, 0);
+}
+
+TEST(ReductionTestSuite, ProductOverflowTest) {
+    std::vector<int> values = {INT_MIN, INT_MIN};
+    Result result = Product(values);
+    ASSERT_FALSE(result.overflow);
+    ASSERT_EQ(result.value, int64_t{1} << 62);
+
+    values = {INT_MIN, INT_MIN, -2};
+    result = Product(values);
+    ASSERT_FALSE(result.overflow);
+    ASSERT_EQ(result.value, std::numeric_limits<int64_t>::min());
+
+    values = {INT_MIN, INT_MIN, 2};
+    ASSERT_TRUE(Product(values).overflow);
+    values = {INT_MIN, INT_MIN, INT_MIN};
+    ASSERT_TRUE(Product(values).overflow);
+
+    ASSERT_EQ(Product({}).value, 1);
+}
+
+TEST(ReductionTestSuite, ProductZeroTest) {
+    std::vector<int> values(100, INT_MAX);
+    ASSERT_TRUE(Product(values).overflow);
+
+    values.push_back(0);
+    Result result = Product(values);
+    ASSERT_FALSE(result.overflow);
+    ASSERT_EQ(result.value, 0);
+}
+
+TEST(ReductionTestSuite, ThreadsTest) {
+    std::vector<int> values = LongInput();
+    int64_t expected = PlainSum(values);
+    for (size_t threads : {1, 2, 3, 0}) {
+        Result result = Sum(values, threads);
+        ASSERT_FALSE(result.overflow);
+        ASSERT_EQ(result.value, expected);
+    }
+
+    std::vector<int> factors(values.size(), 1);
+    for (size_t i = 0; i < 40; i++) {
+        factors[i * factors.size() / 40] = 2;
+    }
+    factors.back() = -1;
+    for (size_t threads : {1, 2, 3, 0}) {
+        Result result = Product(factors, threads);
+        ASSERT_FALSE(result.overflow);
+        ASSERT_EQ(result.value, -(int64_t{1} << 40));
+    }
+
+    factors[factors.size() / 3] = INT_MAX;
+    factors[2 * factors.size() / 3] = INT_MAX;
+    for (size_t threads : {1, 2, 3, 0}) {
+        ASSERT_TRUE(Product(factors, threads).overflow);
+    }
+
+    factors[factors.size() - 2] = 0;
+    for (size_t threads : {1, 2, 3, 0}) {
+        Result result = Product(factors, threads);
+        ASSERT_FALSE(result.overflow);
+        ASSERT_EQ(result.value, 0);
+    }
+}
+
+TEST(ReductionTestSuite, ScalarKernelsTest) {
+    std::vector<int> values = LongInput();
+    int64_t expected = PlainSum(values);
+    SetVectorKernels(false);
+    for (size_t length : {0, 1, 7, 8, 9, 17}) {
+        std::vector<int> part(values.begin(), values.begin() + length);
+        ASSERT_EQ(Sum(part).value, PlainSum(part));
+    }
+    Result sum = Sum(values, 2);
+    std::vector<int> zero = {3, 1, 4, 1, 5, 9, 2, 6, 0};
+    Result product = Product(zero);
+    SetVectorKernels(true);
+
+    ASSERT_EQ(sum.value, expected);
+    ASSERT_EQ(product.value, 0);
+    ASSERT_FALSE(product.overflow);
+    for (size_t length : {0, 1, 7, 8, 9, 17}) {
+        std::vector<int> part(values.begin(), values.begin() + length);
+        ASSERT_EQ(Sum(part).value, PlainSum(part));
+    }
+}
+
+TEST(ReductionTestSuite, AccumulatorBlocksTest) {
+    int threads = 2;
+    bool sum_chosen = false;
+    Accumulator accumulator(threads, sum_chosen);
+    for (size_t i = 0; i < Accumulator::kBlockSize + 10; i++) {
+        accumulator.Add(INT_MAX);
+    }
+    Result sum = accumulator.Sum();
+    ASSERT_FALSE(sum.overflow);
+    ASSERT_EQ(sum.value, static_cast<int64_t>(Accumulator::kBlockSize + 10) * INT_MAX);
+    // The last block was only summed.
+    ASSERT_THROW(accumulator.Product(), std::logic_error);
+}
+
+TEST(ReductionTestSuite, AccumulatorZeroAfterOverflowTest) {
+    int threads = 1;
+    bool sum_chosen = false;
+    Accumulator accumulator(threads, sum_chosen);
+    for (size_t i = 0; i < Accumulator::kBlockSize; i++) {
+        accumulator.Add(i < 100 ? 2 : 1);
+    }
+    for (size_t i = 0; i < Accumulator::kBlockSize; i++) {
+        accumulator.Add(i == 5 ? 0 : 3);
+    }
+    accumulator.Add(7);
+    Result product = accumulator.Product();
+    ASSERT_FALSE(product.overflow);
+    ASSERT_EQ(product.value, 0);
+}
+
+TEST(ReductionTestSuite, AccumulatorSkippedTest) {
+    int threads = 1;
+    bool sum_chosen = false;
+    Accumulator multiplied(threads, sum_chosen);
+    multiplied.Add(6);
+    multiplied.Add(-7);
+    ASSERT_EQ(multiplied.Product().value, -42);
+    ASSERT_THROW(multiplied.Sum(), std::logic_error);
+
+    // Blocks flushed before the choice are both summed and multiplied, the
+    // ones after it only summed.
+    Accumulator chosen_late(threads, sum_chosen);
+    for (size_t i = 0; i < Accumulator::kBlockSize; i++) {
+        chosen_late.Add(1);
+    }
+    sum_chosen = true;
+    for (size_t i = 0; i < Accumulator::kBlockSize; i++) {
+        chosen_late.Add(2);
+    }
+    chosen_late.Add(3);
+    ASSERT_EQ(chosen_late.Sum().value, static_cast<int64_t>(3 * Accumulator::kBlockSize + 3));
+    ASSERT_THROW(chosen_late.Product(), std::logic_error);
+
+    Accumulator empty(threads, sum_chosen);
+    ASSERT_EQ(empty.Sum().value, 0);
+    ASSERT_EQ(empty.Product().value, 1);
+}